@@ -0,0 +1,111 @@
+#include <algorithm>
+
+#include "DrawBatch.h"
+
+DrawBatch::DrawBatch(QPainter* painter) : m_painter(painter)
+{
+    m_areas.setFillRule(Qt::WindingFill);
+}
+
+DrawBatch::~DrawBatch()
+{
+    Flush();
+}
+
+void DrawBatch::AddPoint(QPointF const& point)
+{
+    if (m_kind != Kind::Points)
+    {
+        Flush();
+        m_kind = Kind::Points;
+    }
+
+    m_points.push_back(point);
+}
+
+void DrawBatch::AddLine(QLineF const& line)
+{
+    if (m_kind != Kind::Lines)
+    {
+        Flush();
+        m_kind = Kind::Lines;
+    }
+
+    m_lines.push_back(line);
+}
+
+void DrawBatch::AddPolygon(QPolygonF const& polygon)
+{
+    QPainterPath area;
+    area.addPolygon(polygon);
+    area.closeSubpath();
+    addArea(area);
+}
+
+void DrawBatch::AddEllipse(QPointF const& centre, double rx, double ry, double angle)
+{
+    static auto const unitCircle = []()
+        {
+            QPainterPath circle;
+            circle.addEllipse(QPointF(0., 0.), 1., 1.);
+            return circle;
+        }();
+
+    auto trans = QTransform().translate(centre.x(), centre.y()).rotate(angle).scale(rx, ry);
+    addArea(trans.map(unitCircle));
+}
+
+void DrawBatch::Flush()
+{
+    if (m_kind == Kind::Points && !m_points.empty())
+    {
+        m_painter->drawPoints(m_points.data(), static_cast<int>(m_points.size()));
+        ++m_submits;
+    }
+
+    if (m_kind == Kind::Lines && !m_lines.empty())
+    {
+        m_painter->drawLines(m_lines.data(), static_cast<int>(m_lines.size()));
+        ++m_submits;
+    }
+
+    if (m_kind == Kind::Areas && !m_areaBounds.empty())
+    {
+        m_painter->drawPath(m_areas);
+        ++m_submits;
+    }
+
+    m_kind = Kind::None;
+    m_points.clear();
+    m_lines.clear();
+    m_areas.clear();
+    m_areas.setFillRule(Qt::WindingFill);
+    m_areaBounds.clear();
+    m_united = QRectF();
+}
+
+int DrawBatch::Submits() const
+{
+    return m_submits;
+}
+
+void DrawBatch::addArea(QPainterPath const& area)
+{
+    auto bounds = area.boundingRect();
+
+    // the outlines of one path are stroked over all of its fills, so an area
+    // may only join the batch if it does not overlap the ones already in it
+    auto overlaps = m_kind == Kind::Areas && m_united.intersects(bounds) &&
+        std::any_of(m_areaBounds.cbegin(), m_areaBounds.cend(),
+            [&bounds](QRectF const& other) { return other.intersects(bounds); });
+
+    if (m_kind != Kind::Areas || overlaps || m_areaBounds.size() >= MaxAreas)
+    {
+        Flush();
+        m_kind = Kind::Areas;
+    }
+
+    m_areas.addPath(area);
+    m_areaBounds.push_back(bounds);
+    m_united = m_united.isNull() ? bounds : m_united.united(bounds);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include <QLineF>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPolygonF>
+
+// Collects consecutive shapes that are drawn with the painter's current pen and
+// brush and submits them with one call per run: points and lines through
+// drawPoints/drawLines, rects and ellipses as one pre-transformed path. The shapes
+// have to be added in z-order, an area that overlaps the pending ones flushes them
+// first so it still covers them.
+class DrawBatch
+{
+    public:
+    enum class Kind {
+        None, Lines, Areas, Points
+    };
+
+    DrawBatch(QPainter* painter);
+    ~DrawBatch();
+    void AddPoint(QPointF const& point);
+    void AddLine(QLineF const& line);
+    void AddPolygon(QPolygonF const& polygon);
+    void AddEllipse(QPointF const& centre, double rx, double ry, double angle);
+    void Flush();
+    int Submits() const;
+
+    private:
+    void addArea(QPainterPath const& area);
+
+    // a batch is bounded so the overlap test stays cheap
+    static constexpr size_t MaxAreas = 256;
+
+    QPainter* m_painter;
+    Kind m_kind = Kind::None;
+    std::vector<QPointF> m_points;
+    std::vector<QLineF> m_lines;
+    QPainterPath m_areas;
+    std::vector<QRectF> m_areaBounds;
+    QRectF m_united;
+    int m_submits = 0;
+};
@@ -1,85 +1,212 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
 #include "DrawableActor.h"
+#include "DrawBatch.h"
+#include "UndoStack.h"
 
 DrawableActor::DrawableActor(
     MovableActorPtr const& movableActor,
-    std::function<void()> updateHandler):
+    std::function<void()> updateHandler,
+    RegionHandler regionHandler):
     m_movableActor(movableActor),
-    m_updateHandler(updateHandler)
+    m_updateHandler(updateHandler),
+    m_regionHandler(regionHandler)
 {
 }
 
-auto DrawableActor::getSelected()
+DrawableActor::UpdateScope::UpdateScope(DrawableActor& actor) : m_actor(actor)
 {
-    return std::find_if(m_drawables.cbegin(), m_drawables.cend(),
-        [](const NodeModelRepPtr& drw) {
-            return drw->GetModel()->IsSelected();
-        });
+    ++m_actor.m_updateScopes;
+}
+
+DrawableActor::UpdateScope::~UpdateScope()
+{
+    if (--m_actor.m_updateScopes > 0)
+        return;
+
+    auto oldBounds = std::exchange(m_actor.m_pendingOld, QRectF());
+    auto newBounds = std::exchange(m_actor.m_pendingNew, QRectF());
+    if (!oldBounds.isNull() || !newBounds.isNull())
+        m_actor.m_regionHandler(oldBounds, newBounds);
 }
 
 DrawableActor::NodeModelRepPtr DrawableActor::GetSelected()
 {
-    return *getSelected();
+    if (m_selection.Empty())
+        return nullptr;
+
+    return SharedRep(*m_selection.begin());
 }
 
-void DrawableActor::DeletSelected()
+std::vector<DrawableActor::NodeModelRepPtr> DrawableActor::GetDrawables() const
 {
-    auto selectedDrw = getSelected();
+    std::vector<NodeModelRepPtr> drawables;
+    drawables.reserve(m_drawables.size());
+    for (auto const& [zOrder, drawable] : m_drawables)
+        drawables.push_back(drawable);
+    return drawables;
+}
 
-    if (selectedDrw != m_drawables.cend())
+QRectF DrawableActor::SceneBounds() const
+{
+    QRectF bounds;
+    for (auto const& [zOrder, drawable] : m_drawables)
+        bounds |= m_index.Bounds(drawable.get());
+    return bounds;
+}
+
+NodeModelRep* DrawableActor::FindRep(NodeModel* model) const
+{
+    auto drawable = m_drawables.find(model->GetZOrder());
+    if (drawable == m_drawables.cend() || drawable->second->GetModel().get() != model)
+        return nullptr;
+
+    return drawable->second.get();
+}
+
+DrawableActor::NodeModelRepPtr DrawableActor::SharedRep(NodeModelRep const* drawable) const
+{
+    auto found = find(drawable);
+    return found == m_drawables.cend() ? nullptr : found->second;
+}
+
+void DrawableActor::DeletSelected()
+{
+    UpdateScope scope(*this);
+    std::vector<NodeModelRepPtr> removed;
+    for (auto drawable : m_selection.Items())
     {
-        auto selectedModel = selectedDrw->get()->GetModel();
-        m_movableActor->RemoveNodeModel(selectedModel);
-        m_drawables.erase(selectedDrw);
-        refresh();
-        m_updateHandler();
+        auto found = find(drawable);
+        if (found == m_drawables.cend())
+            continue;
+
+        removed.push_back(found->second);
+        remove(found);
     }
+    m_selection.Clear();
+
+    if (m_undoStack != nullptr)
+        m_undoStack->RecordRemove(removed);
 }
 
 void DrawableActor::BringSelectedToFront()
 {
-    auto selectedDrw = getSelected();
-    if (selectedDrw >= m_drawables.cend() - 1)
+    PERF_SCOPE_TIMER(m_refreshNs);
+    auto selected = selectedInZOrder();
+    if (selected.empty())
+        return;
+
+    // nothing to do if the selection already is in front of the rest
+    auto front = m_drawables.crbegin();
+    auto inFront = std::all_of(selected.crbegin(), selected.crend(),
+        [&front](NodeModelRep* drawable) { return (front++)->second.get() == drawable; });
+    if (inFront && m_drawables.crbegin()->first >= m_reservedMaxZ)
         return;
 
-    auto topDrw = m_drawables.cend() - 1;
-    auto maxZ = topDrw->get()->GetModel()->GetZOrder();
-    selectedDrw->get()->GetModel()->SetZOrder(maxZ + 1.0);
-    refresh();
+    // the selected shapes keep their order among themselves
+    UpdateScope scope(*this);
+    std::vector<NodeModelRepPtr> shapes;
+    std::vector<double> before;
+    auto zOrder = frontZOrder() - 1.0;
+    for (auto drawable : selected)
+    {
+        auto found = find(drawable);
+        shapes.push_back(found->second);
+        before.push_back(found->first);
+        reorder(found, ++zOrder);
+    }
+
+    if (m_undoStack != nullptr)
+        m_undoStack->RecordZOrders(std::move(shapes), std::move(before));
 }
 
 void DrawableActor::SendSelectedToBack()
 {
-    auto selectedDrw = getSelected();
-    auto backDrw = m_drawables.cbegin();
+    PERF_SCOPE_TIMER(m_refreshNs);
+    auto selected = selectedInZOrder();
+    if (selected.empty())
+        return;
 
-    if (selectedDrw == backDrw)
+    auto back = m_drawables.cbegin();
+    auto atBack = std::all_of(selected.cbegin(), selected.cend(),
+        [&back](NodeModelRep* drawable) { return (back++)->second.get() == drawable; });
+    if (atBack && m_drawables.cbegin()->first <= m_reservedMinZ)
         return;
 
-    auto minZ = backDrw->get()->GetModel()->GetZOrder();
-    selectedDrw->get()->GetModel()->SetZOrder(minZ - 1.0);
-    refresh();
+    UpdateScope scope(*this);
+    std::vector<NodeModelRepPtr> shapes;
+    std::vector<double> before;
+    auto zOrder = backZOrder() + 1.0;
+    for (auto drawable = selected.crbegin(); drawable != selected.crend(); ++drawable)
+    {
+        auto found = find(*drawable);
+        shapes.push_back(found->second);
+        before.push_back(found->first);
+        reorder(found, --zOrder);
+    }
+
+    if (m_undoStack != nullptr)
+        m_undoStack->RecordZOrders(std::move(shapes), std::move(before));
+}
+
+void DrawableActor::MoveSelected(QVector2D const& delta, NodeModel const* except)
+{
+    UpdateScope scope(*this);
+    std::vector<NodeModelRepPtr> moved;
+    for (auto drawable : m_selection)
+    {
+        auto model = drawable->GetModel();
+        if (model.get() == except)
+            continue;
+
+        model->MoveBy(delta);
+        if (m_undoStack != nullptr)
+            moved.push_back(SharedRep(drawable));
+    }
+
+    if (m_undoStack != nullptr)
+        m_undoStack->RecordMove(std::move(moved), delta);
 }
 
 void DrawableActor::UnSelectAll()
 {
-    for (auto drawable : m_drawables)
+    UpdateScope scope(*this);
+    for (auto drawable : m_selection.Items())
     {
+        // the handles go away with the selection
         drawable->GetModel()->SetSelected(false);
+        auto bounds = m_index.Bounds(drawable);
+        updateRegion(bounds, bounds);
     }
-    m_updateHandler();
 }
 
 void DrawableActor::SelectOn(QPointF const& pos)
 {
-    for (auto drawable : m_drawables)
-    {
-        if (!drawable->GetModel()->IsPointOn(pos))
-            continue;
+    auto selected = ModelOn(pos);
+    if (selected == nullptr)
+        return;
 
-        drawable->GetModel()->SetSelected(true);
-        m_updateHandler();
-        break;
-    }
+    selected->SetSelected(true);
+    auto bounds = selected->Bounds();
+    updateRegion(bounds, bounds);
+}
+
+NodeModel* DrawableActor::ModelOn(QPointF const& pos) const
+{
+    NodeModel* found = nullptr;
+    m_index.Query(pos, [&pos, &found](NodeModelRep* drawable, QRectF const&)
+        {
+            auto model = drawable->GetModel().get();
+            if (found != nullptr && found->GetZOrder() >= model->GetZOrder())
+                return;
+
+            if (model->IsPointOn(pos))
+                found = model;
+        });
+
+    return found;
 }
 
 // the text could/should have a parent
@@ -87,57 +214,335 @@ void DrawableActor::SelectOn(QPointF const& pos)
 
 // movables group // get next shape ? // add
 
-bool DrawableActor::AnySelected()
+bool DrawableActor::AnySelected() const
+{
+    return !m_selection.Empty();
+}
+
+SelectionSet<NodeModelRep*> const& DrawableActor::Selection() const
 {
-    return getSelected() != m_drawables.cend();
+    return m_selection;
 }
 
 void DrawableActor::Add(DrawableActor::NodeModelRepPtr const& drawable)
 {
-    QObject::connect(drawable->GetModel().get(), &NodeModel::Changed, m_updateHandler);
-    drawable->GetModel()->SetParentToNodes(drawable->GetModel());
-    auto topDrw = std::max_element(m_drawables.cbegin(), m_drawables.cend(),
-        [](NodeModelRepPtr const& a, NodeModelRepPtr const& b)
+    add(drawable, frontZOrder());
+}
+
+void DrawableActor::AddAll(std::span<NodeModelRepPtr const> drawables)
+{
+    UpdateScope scope(*this);
+    auto zOrder = frontZOrder();
+    for (auto const& drawable : drawables)
+    {
+        if (!m_index.Contains(drawable.get()))
+            add(drawable, zOrder++);
+    }
+}
+
+void DrawableActor::Insert(NodeModelRepPtr const& drawable)
+{
+    auto zOrder = drawable->GetModel()->GetZOrder();
+    add(drawable, m_drawables.contains(zOrder) ? frontZOrder() : zOrder);
+}
+
+void DrawableActor::Remove(std::span<NodeModelRepPtr const> drawables)
+{
+    UpdateScope scope(*this);
+    for (auto const& drawable : drawables)
+    {
+        auto found = find(drawable.get());
+        if (found != m_drawables.cend())
+            remove(found);
+    }
+}
+
+void DrawableActor::Reorder(NodeModelRep const* drawable, double zOrder)
+{
+    auto found = find(drawable);
+    if (found != m_drawables.cend() && !m_drawables.contains(zOrder))
+        reorder(found, zOrder);
+}
+
+void DrawableActor::Repaint(NodeModelRep const* drawable)
+{
+    auto found = find(drawable);
+    if (found == m_drawables.cend())
+        return;
+
+    auto bounds = m_index.Bounds(found->second.get());
+    updateRegion(bounds, bounds);
+}
+
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+DrawableActor::Counters DrawableActor::GetCounters() const
+{
+    return { m_drawables.size(), m_sortNs.load(), m_refreshNs, m_changes };
+}
+#endif
+
+void DrawableActor::SetUndoStack(std::shared_ptr<UndoStack> undoStack)
+{
+    m_undoStack = std::move(undoStack);
+}
+
+UndoStack* DrawableActor::GetUndoStack() const
+{
+    return m_undoStack.get();
+}
+
+void DrawableActor::ReserveZOrders(double minZ, double maxZ)
+{
+    m_reservedMinZ = std::min(m_reservedMinZ, minZ);
+    m_reservedMaxZ = std::max(m_reservedMaxZ, maxZ);
+}
+
+DrawableActor::DrawStats DrawableActor::DrawAll(QPainter* painter, QRectF const& visibleRect,
+    double aboveZ, double belowZ) const
+{
+    std::vector<NodeModelRep*> visibles;
+    m_index.Query(visibleRect, [&visibles](NodeModelRep* drawable, QRectF const&) { visibles.push_back(drawable); });
+
+    {
+        PERF_SCOPE_TIMER(m_sortNs);
+        if (2 * visibles.size() >= m_drawables.size())
         {
-            return a->GetModel()->GetZOrder() < b->GetModel()->GetZOrder();
-        });
-    auto maxZ = (topDrw != m_drawables.cend()) ? topDrw->get()->GetModel()->GetZOrder() : 0.0;
-    drawable->GetModel()->SetZOrder(maxZ + 1.0);
+            // most of the scene is in view, the map is in drawing order already
+            visibles.clear();
+            auto first = m_drawables.upper_bound(aboveZ);
+            auto end = belowZ > aboveZ ? m_drawables.lower_bound(belowZ) : first;
+            for (auto drawable = first; drawable != end; ++drawable)
+            {
+                if (m_index.Intersects(drawable->second.get(), visibleRect))
+                    visibles.push_back(drawable->second.get());
+            }
+        }
+        else
+        {
+            // the z-orders are read once and sorted as plain values
+            std::vector<std::pair<double, NodeModelRep*>> ordered;
+            ordered.reserve(visibles.size());
+            for (auto drawable : visibles)
+            {
+                auto z = drawable->GetModel()->GetZOrder();
+                if (z > aboveZ && z < belowZ)
+                    ordered.emplace_back(z, drawable);
+            }
+            std::sort(ordered.begin(), ordered.end(),
+                [](auto const& a, auto const& b) { return a.first < b.first; });
 
-    m_drawables.push_back(drawable);
-    m_movableActor->Add(drawable->GetModel());
-    refresh();
+            visibles.clear();
+            for (auto const& [z, drawable] : ordered)
+                visibles.push_back(drawable);
+        }
+    }
+
+    // the level of detail follows the scale of the painter, so it holds for tiles and layers too
+    auto const& lod = m_lodPolicy;
+    auto scale = std::sqrt(std::abs(painter->worldTransform().determinant()));
+    auto textPixels = painter->fontMetrics().height() * scale;
+    auto withHandles = !lod.enabled || scale >= lod.handlesMinScale;
+    auto greekText = lod.enabled && textPixels < lod.textMinPixels;
+
+    // the batch is flushed before every shape it cannot take, so the z-order holds
+    DrawStats stats;
+    DrawBatch batch(painter);
+    for (auto drawable : visibles)
+    {
+        auto model = drawable->GetModel();
+        if (lod.enabled)
+        {
+            auto shape = model->ShapeBounds();
+            auto pixels = std::max(shape.width(), shape.height()) * scale;
+            if (pixels < lod.skipMaxPixels)
+            {
+                ++stats.lodSkipped;
+                continue;
+            }
+            if (pixels < lod.pointMaxPixels)
+            {
+                ++stats.lodPoints;
+                if (m_batched)
+                    batch.AddPoint(shape.center());
+                else
+                    painter->drawPoint(shape.center());
+                continue;
+            }
+        }
+
+        auto selected = model->IsSelected();
+        if (selected && !withHandles)
+            ++stats.lodHandlesSkipped;
+
+        if (greekText && drawable->HasText())
+        {
+            ++stats.lodGreeked;
+            batch.Flush();
+            drawable->DrawGreeked(painter);
+        }
+        else
+        {
+            ++stats.lodFull;
+            if (!m_batched || (selected && withHandles) || !drawable->AddTo(batch))
+            {
+                batch.Flush();
+                drawable->DrawShape(painter);
+            }
+        }
+
+        if (selected && withHandles)
+            drawable->DrawHandles(painter);
+    }
+    batch.Flush();
+
+    stats.batches = batch.Submits();
+    stats.drawn = static_cast<int>(visibles.size()) - stats.lodSkipped;
+    stats.culled = static_cast<int>(m_drawables.size()) - static_cast<int>(visibles.size());
+    return stats;
+}
+
+void DrawableActor::SetBatched(bool batched)
+{
+    m_batched = batched;
+    m_updateHandler();
+}
+
+void DrawableActor::SetLodPolicy(LodPolicy const& policy)
+{
+    m_lodPolicy = policy;
     m_updateHandler();
 }
 
-void DrawableActor::DrawAll(QPainter* painter)
+DrawableActor::LodPolicy DrawableActor::GetLodPolicy() const
 {
-    for (auto drawable : m_drawables)
-        drawable->Draw(painter);
+    return m_lodPolicy;
 }
 
 void DrawableActor::Clear()
 {
+    for (auto const& [zOrder, drawable] : m_drawables)
+    {
+        drawable->GetModel()->RemoveChangeListener(this);
+        drawable->GetModel()->RemoveSelectionListener(this);
+    }
+
+    // the shapes only referenced here are destroyed together, their arena goes with the last one
+    m_movableActor->Clear();
+    m_index.Clear();
+    m_selection.Clear();
+    m_drawables.clear();
+    m_reservedMinZ = std::numeric_limits<double>::infinity();
+    m_reservedMaxZ = -std::numeric_limits<double>::infinity();
+    m_updateHandler();
+}
+
+void DrawableActor::add(NodeModelRepPtr const& drawable, double zOrder)
+{
+    if (m_index.Contains(drawable.get()))
+        return;
+
+    drawable->GetModel()->AddChangeListener(this, [this, drw = drawable.get()]()
+        {
+            PERF_COUNT(m_changes);
+            updateBounds(drw);
+        });
+    drawable->GetModel()->AddSelectionListener(this, [this, drw = drawable.get()](bool selected)
+        {
+            if (selected)
+                m_selection.Insert(drw);
+            else
+                m_selection.Erase(drw);
+        });
+    if (drawable->GetModel()->IsSelected())
+        m_selection.Insert(drawable.get());
+
+    drawable->GetModel()->SetParentToNodes(drawable->GetModel());
+
+    drawable->GetModel()->SetZOrder(zOrder);
+    // shapes mostly come on top, the hint makes that constant time
+    m_drawables.emplace_hint(m_drawables.cend(), zOrder, drawable);
+    m_movableActor->Add(drawable->GetModel());
+    updateBounds(drawable.get());
+}
+
+double DrawableActor::frontZOrder() const
+{
+    auto front = m_reservedMaxZ;
+    if (!m_drawables.empty())
+        front = std::max(front, m_drawables.crbegin()->first);
+
+    return std::isinf(front) ? 0.0 : front + 1.0;
+}
+
+double DrawableActor::backZOrder() const
+{
+    auto back = m_reservedMinZ;
+    if (!m_drawables.empty())
+        back = std::min(back, m_drawables.cbegin()->first);
+
+    return std::isinf(back) ? 0.0 : back - 1.0;
 }
 
-void DrawableActor::refresh()
+DrawableActor::DrawableMap::const_iterator DrawableActor::find(NodeModelRep const* drawable) const
 {
-    std::sort(m_drawables.begin(), m_drawables.end()); // sort to earase duplicates
-    m_drawables.erase(
-        std::unique(m_drawables.begin(), m_drawables.end()), m_drawables.end());
+    auto found = m_drawables.find(drawable->GetModel()->GetZOrder());
+    if (found == m_drawables.cend() || found->second.get() != drawable)
+        return m_drawables.cend();
 
-    std::sort(m_drawables.begin(), m_drawables.end(), 
-        [](const NodeModelRepPtr& a, const NodeModelRepPtr& b)
+    return found;
+}
+
+std::vector<NodeModelRep*> DrawableActor::selectedInZOrder() const
+{
+    std::vector<NodeModelRep*> selected(m_selection.begin(), m_selection.end());
+    std::sort(selected.begin(), selected.end(), [](NodeModelRep* a, NodeModelRep* b)
         {
-            // draw in ascending order
             return a->GetModel()->GetZOrder() < b->GetModel()->GetZOrder();
         });
+    return selected;
+}
+
+void DrawableActor::remove(DrawableMap::const_iterator drawable)
+{
+    // keeps the shape alive until it is out of every index
+    auto drw = drawable->second;
+    auto oldBounds = m_index.Bounds(drw.get());
+    m_movableActor->RemoveNodeModel(drw->GetModel());
+    drw->GetModel()->RemoveChangeListener(this);
+    drw->GetModel()->RemoveSelectionListener(this);
+    m_index.Remove(drw.get());
+    m_selection.Erase(drw.get());
+    m_drawables.erase(drawable);
+    updateRegion(oldBounds, QRectF());
+}
+
+void DrawableActor::reorder(DrawableMap::const_iterator drawable, double zOrder)
+{
+    auto drw = drawable->second;
+    m_drawables.erase(drawable);
+    m_movableActor->Reorder(drw->GetModel(), zOrder);
+    m_drawables.emplace(zOrder, drw);
+
+    auto bounds = m_index.Bounds(drw.get());
+    updateRegion(bounds, bounds);
+}
+
+void DrawableActor::updateBounds(NodeModelRep* drawable)
+{
+    auto oldBounds = m_index.Bounds(drawable);
+    auto newBounds = drawable->Bounds();
+    m_index.Update(drawable, newBounds);
+    updateRegion(oldBounds, newBounds);
+}
 
-    m_movableActor->Refresh();
-    // refresh z-order values
-    std::for_each(m_drawables.begin(), m_drawables.end(),
-        [n = 0.0](NodeModelRepPtr& drawable) mutable
+void DrawableActor::updateRegion(QRectF const& oldBounds, QRectF const& newBounds)
+{
+    if (m_updateScopes == 0)
     {
-        drawable->GetModel()->SetZOrder(n++);
-    });
+        m_regionHandler(oldBounds, newBounds);
+        return;
+    }
+
+    m_pendingOld |= oldBounds;
+    m_pendingNew |= newBounds;
 }
@@ -1,8 +1,18 @@
 #pragma once
+#include <atomic>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
 #include <vector>
 
 #include "drawables.h"
 #include "MovableActor.h"
+#include "PerfCounters.h"
+#include "SelectionSet.h"
+#include "SpatialIndex.h"
+
+class UndoStack;
 
 class DrawableActor
 {
@@ -14,23 +24,155 @@ class DrawableActor
         Chord, Pie, Path, Text, Pixmap, Node
     };
 
-    DrawableActor(MovableActorPtr const& movableActor, std::function<void()> updateHandler);
+    struct DrawStats
+    {
+        int drawn = 0;
+        int culled = 0;
+        // painter calls issued for batched shapes
+        int batches = 0;
+        // shapes per level of detail, the skipped ones are not counted as drawn
+        int lodFull = 0;
+        int lodGreeked = 0;
+        int lodPoints = 0;
+        int lodSkipped = 0;
+        int lodHandlesSkipped = 0;
+
+        // adds up the shapes of several passes, culled only makes sense per pass
+        DrawStats& operator+=(DrawStats const& other)
+        {
+            drawn += other.drawn;
+            batches += other.batches;
+            lodFull += other.lodFull;
+            lodGreeked += other.lodGreeked;
+            lodPoints += other.lodPoints;
+            lodSkipped += other.lodSkipped;
+            lodHandlesSkipped += other.lodHandlesSkipped;
+            return *this;
+        }
+    };
+
+    // thresholds of the level of detail, in device pixels unless noted otherwise
+    struct LodPolicy
+    {
+        bool enabled = true;
+        // scene scale below which the handles of selected shapes are left out
+        double handlesMinScale = .5;
+        // texts whose line height is below this are drawn as grey bars
+        double textMinPixels = 6.;
+        // shapes smaller than this are drawn as a single point
+        double pointMaxPixels = 3.;
+        // and the ones smaller than this are not drawn at all
+        double skipMaxPixels = 1.;
+    };
+
+    // regionHandler receives the scene space areas to repaint, updateHandler repaints everything
+    using RegionHandler = std::function<void(QRectF const& oldBounds, QRectF const& newBounds)>;
+
+    // while a scope is open the areas to repaint are merged and handed on once,
+    // when the outermost scope closes
+    class UpdateScope
+    {
+        public:
+        UpdateScope(DrawableActor& actor);
+        ~UpdateScope();
+
+        private:
+        DrawableActor& m_actor;
+    };
+
+    DrawableActor(MovableActorPtr const& movableActor,
+        std::function<void()> updateHandler,
+        RegionHandler regionHandler);
+    // the operations on the selection are applied to all selected shapes with one repaint
     void DeletSelected();
     void BringSelectedToFront();
     void SendSelectedToBack();
-    bool AnySelected();
+    void MoveSelected(QVector2D const& delta, NodeModel const* except = nullptr);
+    bool AnySelected() const;
+    SelectionSet<NodeModelRep*> const& Selection() const;
     void Add(NodeModelRepPtr const& drawable);
-    void DrawAll(QPainter* painter);
+    // adds the shapes on top in their order with one repaint
+    void AddAll(std::span<NodeModelRepPtr const> drawables);
+    // adds the shape at the z-order its model has, on top if that one is taken
+    void Insert(NodeModelRepPtr const& drawable);
+    void Remove(std::span<NodeModelRepPtr const> drawables);
+    // moves a shape to a free z-order
+    void Reorder(NodeModelRep const* drawable, double zOrder);
+    // repaints a shape that changed without its model knowing, like an edited text
+    void Repaint(NodeModelRep const* drawable);
+    // deletions, z-order changes and moves of the selection are recorded there
+    void SetUndoStack(std::shared_ptr<UndoStack> undoStack);
+    UndoStack* GetUndoStack() const;
+    // z-orders used by shapes that are not added yet, new and re-ordered shapes go past them
+    void ReserveZOrders(double minZ, double maxZ);
+    // draws the visible shapes with aboveZ < z-order < belowZ
+    DrawStats DrawAll(QPainter* painter, QRectF const& visibleRect,
+        double aboveZ = -std::numeric_limits<double>::infinity(),
+        double belowZ = std::numeric_limits<double>::infinity()) const;
+    // groups consecutive rects, ellipses and lines into array/path submissions
+    void SetBatched(bool batched);
+    void SetLodPolicy(LodPolicy const& policy);
+    LodPolicy GetLodPolicy() const;
     void UnSelectAll();
     void SelectOn(QPointF const& pos);
+    // the topmost model under pos, nullptr if there is none
+    NodeModel* ModelOn(QPointF const& pos) const;
     void Clear();
     NodeModelRepPtr GetSelected();
+    // all shapes from the back to the front
+    std::vector<NodeModelRepPtr> GetDrawables() const;
+    // the area the shapes are drawn on, handles included
+    QRectF SceneBounds() const;
+    NodeModelRep* FindRep(NodeModel* model) const;
+    NodeModelRepPtr SharedRep(NodeModelRep const* drawable) const;
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    struct Counters
+    {
+        size_t shapes = 0;
+        // the last sort of the visible shapes in DrawAll and the last z-order change of the selection
+        qint64 sortNs = 0;
+        qint64 refreshNs = 0;
+        // model changes seen so far
+        quint64 changes = 0;
+    };
+    Counters GetCounters() const;
+#endif
 
     private:
-    auto getSelected();
-    void refresh();
+    // shapes in drawing order, keyed by their z-order. The keys are whole numbers
+    // and a moved shape goes past the current front or back, so no renumbering is needed
+    using DrawableMap = std::map<double, NodeModelRepPtr>;
+
+    void add(NodeModelRepPtr const& drawable, double zOrder);
+    // the z-orders in front of and behind all shapes, the reserved ones included
+    double frontZOrder() const;
+    double backZOrder() const;
+    DrawableMap::const_iterator find(NodeModelRep const* drawable) const;
+    // the selected shapes from the back to the front
+    std::vector<NodeModelRep*> selectedInZOrder() const;
+    void remove(DrawableMap::const_iterator drawable);
+    void reorder(DrawableMap::const_iterator drawable, double zOrder);
+    void updateBounds(NodeModelRep* drawable);
+    void updateRegion(QRectF const& oldBounds, QRectF const& newBounds);
 
-    std::vector<NodeModelRepPtr> m_drawables;
+    DrawableMap m_drawables;
+    SpatialIndex<NodeModelRep*> m_index;
+    SelectionSet<NodeModelRep*> m_selection;
+    double m_reservedMinZ = std::numeric_limits<double>::infinity();
+    double m_reservedMaxZ = -std::numeric_limits<double>::infinity();
+    int m_updateScopes = 0;
+    QRectF m_pendingOld;
+    QRectF m_pendingNew;
+    bool m_batched = false;
+    LodPolicy m_lodPolicy;
     MovableActorPtr m_movableActor;
     std::function<void()> m_updateHandler;
+    RegionHandler m_regionHandler;
+    std::shared_ptr<UndoStack> m_undoStack;
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    // DrawAll runs on the drawing threads too
+    mutable std::atomic<qint64> m_sortNs = 0;
+    qint64 m_refreshNs = 0;
+    quint64 m_changes = 0;
+#endif
 };
\ No newline at end of file
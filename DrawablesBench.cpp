@@ -0,0 +1,689 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QResizeEvent>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include "DrawableActor.h"
+#include "DrawablesScene.h"
+#include "MovableActor.h"
+#include "PosterExport.h"
+#include "SceneFile.h"
+#include "SceneImporter.h"
+#include "ShapeArena.h"
+#include "SyntheticScene.h"
+
+// Headless frame time benchmark: builds synthetic scenes through DrawablesInit,
+// renders them with DrawablesScene::Draw into a QImage and replays picks, z-order
+// changes and drags through the actors. Prints per phase timings as JSON.
+// With --kernels it times the model kernels in isolation instead.
+
+// counts the heap allocations of the process, for the shape building phases
+static std::atomic<size_t> heapAllocations{ 0 };
+
+void* operator new(size_t size)
+{
+    ++heapAllocations;
+    if (auto ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace
+{
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+
+    const QSize FrameSize(1920, 1080);
+
+    // runs the phase `repeats` times and summarises the timings in milliseconds
+    QJsonObject Measure(int repeats, std::function<void()> const& phase)
+    {
+        std::vector<double> times;
+        QElapsedTimer timer;
+        for (auto i = 0; i < repeats; ++i)
+        {
+            timer.start();
+            phase();
+            times.push_back(timer.nsecsElapsed() / 1e6);
+        }
+
+        std::sort(times.begin(), times.end());
+        auto total = 0.;
+        for (auto time : times)
+            total += time;
+
+        return QJsonObject{
+            { "runs", repeats },
+            { "min_ms", times.front() },
+            { "median_ms", times[times.size() / 2] },
+            { "mean_ms", total / repeats },
+            { "max_ms", times.back() },
+        };
+    }
+
+    void SetSelected(std::vector<NodeModelRepPtr> const& shapes, bool selected)
+    {
+        for (auto const& shape : shapes)
+            shape->GetModel()->SetSelected(selected);
+    }
+
+    // builds and frees the shapes on the heap and in an arena, counting the heap allocations
+    QJsonObject Build(int count)
+    {
+        QJsonObject result;
+        for (auto inArena : { false, true })
+        {
+            auto arena = inArena ? std::make_shared<ShapeArena>() : nullptr;
+            auto allocations = heapAllocations.load();
+
+            QElapsedTimer timer;
+            timer.start();
+            std::vector<NodeModelRepPtr> shapes;
+            {
+                ShapeArena::Scope scope(arena);
+                shapes = SyntheticScene::Generate(count);
+            }
+
+            QJsonObject build{
+                { "build_ms", timer.nsecsElapsed() / 1e6 },
+                { "heap_allocations", qint64(heapAllocations.load() - allocations) },
+            };
+            if (arena != nullptr)
+                build["arena_allocations"] = qint64(arena->Allocations());
+
+            timer.start();
+            shapes.clear();
+            arena.reset();
+            build["free_ms"] = timer.nsecsElapsed() / 1e6;
+            result[inArena ? "arena" : "heap"] = build;
+        }
+        return result;
+    }
+
+    // saves the scene and loads it back, SceneFileTest checks what comes back
+    QJsonObject RoundTrip(DrawablesScene& scene, int frames)
+    {
+        QTemporaryDir dir;
+        auto fileName = dir.filePath("bench.idscene");
+
+        QJsonObject result;
+        result["save"] = Measure(1, [&]() { scene.Save(fileName); });
+        result["bytes"] = QFileInfo(fileName).size();
+
+        std::optional<std::vector<NodeModelRepPtr>> loaded;
+        result["load"] = Measure(frames, [&]()
+            {
+                loaded.reset();
+                ShapeArena::Scope scope(std::make_shared<ShapeArena>());
+                loaded = SceneFile::Load(fileName);
+            });
+        result["shapes"] = loaded.has_value() ? qint64(loaded->size()) : -1;
+        return result;
+    }
+
+    // reads a diagram on the calling thread only and on the pool
+    QJsonObject ReadTimes(QString const& fileName, int frames,
+        std::optional<std::vector<SceneImporter::Record>>& records)
+    {
+        QJsonObject result;
+        result["bytes"] = QFileInfo(fileName).size();
+        result["read_serial"] = Measure(frames, [&]() { records = SceneImporter::Read(fileName, nullptr, 1); });
+        result["read_pooled"] = Measure(frames, [&]() { records = SceneImporter::Read(fileName); });
+        return result;
+    }
+
+    // writes the scene as JSON and SVG diagrams of upright boxes, reads them back
+    // and imports the JSON one into an empty scene
+    QJsonObject Import(DrawablesScene& source, int frames)
+    {
+        auto drawables = source.GetDrawableActor()->GetDrawables();
+        QJsonArray shapes;
+        QByteArray svg("<svg xmlns=\"http://www.w3.org/2000/svg\">\n");
+        for (auto const& shape : drawables)
+        {
+            auto model = shape->GetModel();
+            auto bounds = model->ShapeBounds();
+            QJsonObject json{ { "selected", model->IsSelected() }, { "x", bounds.x() }, { "y", bounds.y() },
+                { "width", bounds.width() }, { "height", bounds.height() } };
+            auto box = QString("x=\"%1\" y=\"%2\" width=\"%3\" height=\"%4\"")
+                .arg(bounds.x()).arg(bounds.y()).arg(bounds.width()).arg(bounds.height());
+
+            if (auto text = dynamic_cast<TextRep const*>(shape.get()))
+            {
+                json["type"] = "text";
+                json["text"] = text->GetText();
+                svg += QString("<text x=\"%1\" y=\"%2\">%3</text>\n")
+                    .arg(bounds.x()).arg(bounds.y()).arg(text->GetText().toHtmlEscaped()).toUtf8();
+            }
+            else if (dynamic_cast<RectRep const*>(shape.get()) != nullptr)
+            {
+                json["type"] = "rect";
+                svg += QString("<rect %1/>\n").arg(box).toUtf8();
+            }
+            else if (dynamic_cast<EllipseRep const*>(shape.get()) != nullptr)
+            {
+                json["type"] = "ellipse";
+                svg += QString("<ellipse cx=\"%1\" cy=\"%2\" rx=\"%3\" ry=\"%4\"/>\n")
+                    .arg(bounds.center().x()).arg(bounds.center().y())
+                    .arg(bounds.width() / 2.).arg(bounds.height() / 2.).toUtf8();
+            }
+            else if (dynamic_cast<VectorRep const*>(shape.get()) != nullptr)
+            {
+                auto const& vector = static_cast<IntVector const&>(*model);
+                auto nodeA = vector.m_nodeA->GetPosition();
+                auto nodeB = vector.m_nodeB->GetPosition();
+                json = QJsonObject{ { "type", "line" }, { "selected", model->IsSelected() },
+                    { "x1", nodeA.x() }, { "y1", nodeA.y() }, { "x2", nodeB.x() }, { "y2", nodeB.y() } };
+                svg += QString("<line x1=\"%1\" y1=\"%2\" x2=\"%3\" y2=\"%4\"/>\n")
+                    .arg(nodeA.x()).arg(nodeA.y()).arg(nodeB.x()).arg(nodeB.y()).toUtf8();
+            }
+            else
+            {
+                json = QJsonObject{ { "type", "node" }, { "selected", model->IsSelected() },
+                    { "x", bounds.center().x() }, { "y", bounds.center().y() } };
+            }
+            shapes.append(json);
+        }
+        svg += "</svg>\n";
+
+        QTemporaryDir dir;
+        auto fileName = dir.filePath("bench.json");
+        QFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return {};
+        file.write(QJsonDocument(QJsonObject{ { "format", "interactive-drawing" }, { "version", 1 },
+            { "shapes", shapes } }).toJson(QJsonDocument::Compact));
+        file.close();
+
+        QFile svgFile(dir.filePath("bench.svg"));
+        if (!svgFile.open(QIODevice::WriteOnly))
+            return {};
+        svgFile.write(svg);
+        svgFile.close();
+
+        std::optional<std::vector<SceneImporter::Record>> records;
+        auto svgTimes = ReadTimes(svgFile.fileName(), frames, records);
+        auto result = ReadTimes(fileName, frames, records);
+        result["svg"] = svgTimes;
+
+        QWidget host;
+        DrawablesScene scene(&host);
+        result["import"] = Measure(1, [&]() { scene.Import(fileName); });
+        result["same_count"] = records.has_value() && records->size() == drawables.size() &&
+            scene.GetDrawableActor()->GetDrawables().size() == drawables.size();
+        return result;
+    }
+
+    // exports the scene 4096 pixels wide as a poster and reports how many tiles were alive at once
+    QJsonObject Poster(DrawablesScene& scene)
+    {
+        QTemporaryDir dir;
+        PosterExport::Options options;
+        options.sceneRect = scene.GetDrawableActor()->SceneBounds();
+        options.scale = 4096. / std::max(options.sceneRect.width(), 1.);
+        options.style = PaintStyle{ QPen(Qt::blue, 1), QBrush(), QPainter::Antialiasing };
+
+        PosterExport poster(*scene.GetDrawableActor());
+        QJsonObject result;
+        result["export"] = Measure(1, [&]() { poster.Export(dir.filePath("bench.pam"), options); });
+
+        auto stats = poster.GetStats();
+        result["width"] = stats.size.width();
+        result["height"] = stats.size.height();
+        result["tiles"] = stats.tiles;
+        result["peak_tiles"] = stats.peakTiles;
+        result["peak_tile_bytes"] = qint64(stats.peakTiles) * options.tileSize * options.tileSize * 4;
+        result["bytes"] = stats.bytes;
+        return result;
+    }
+
+    // pans a paged copy of the scene along its diagonal at 1:1 under a memory budget
+    QJsonObject Paging(DrawablesScene& source, double side, int steps, size_t budget)
+    {
+        QTemporaryDir dir;
+        QJsonObject result;
+        result["build"] = Measure(1, [&]() { source.SavePaged(dir.path()); });
+
+        QWidget host;
+        DrawablesScene scene(&host);
+        QResizeEvent resize(FrameSize, QSize());
+        scene.ResizeHandler(&resize);
+        result["open"] = Measure(1, [&]() { scene.OpenPaged(dir.path()); });
+
+        auto pagedScene = scene.GetPagedScene();
+        if (pagedScene == nullptr)
+            return result;
+
+        pagedScene->SetBudget(budget);
+        auto step = 0;
+        size_t peakBytes = 0;
+        result["pan_step"] = Measure(steps, [&]()
+            {
+                auto along = double(step++ % steps) / steps;
+                scene.SetView(QPointF(side, side) * along, 0);
+                peakBytes = std::max(peakBytes, pagedScene->GetStats().bytes);
+            });
+
+        auto stats = pagedScene->GetStats();
+        result["chunks"] = stats.chunks;
+        result["loaded"] = stats.loaded;
+        result["loads"] = stats.loads;
+        result["evictions"] = stats.evictions;
+        result["peak_bytes"] = qint64(peakBytes);
+        result["budget_bytes"] = qint64(budget);
+        return result;
+    }
+
+    QJsonObject RunScene(int count, int frames, int steps, size_t pageBudget)
+    {
+        QWidget host;
+        DrawablesScene scene(&host);
+        QResizeEvent resize(FrameSize, QSize());
+        scene.ResizeHandler(&resize);
+
+        auto drawableActor = scene.GetDrawableActor();
+        auto movableActor = scene.GetMovableActor();
+        auto side = SyntheticScene::SideLength(count);
+        auto centre = QPointF(side, side) / 2.;
+
+        QJsonObject result{ { "shapes", count } };
+        result["build"] = Build(count);
+
+        std::vector<NodeModelRepPtr> shapes;
+        QElapsedTimer timer;
+        timer.start();
+        {
+            ShapeArena::Scope scope(scene.GetArena());
+            shapes = SyntheticScene::Generate(count);
+        }
+        result["generate_ms"] = timer.nsecsElapsed() / 1e6;
+
+        timer.start();
+        for (auto const& shape : shapes)
+            drawableActor->Add(shape);
+        result["add_ms"] = timer.nsecsElapsed() / 1e6;
+        result["scene_file"] = RoundTrip(scene, frames);
+        result["import"] = Import(scene, frames);
+        result["poster"] = Poster(scene);
+        result["paging"] = Paging(scene, side, steps, pageBudget);
+
+        // paint
+        QImage frame(FrameSize, QImage::Format_ARGB32_Premultiplied);
+        auto paint = [&]()
+        {
+            frame.fill(Qt::white);
+            QPainter painter(&frame);
+            painter.setPen(QPen(Qt::blue, 1));
+            painter.setBrush(QBrush(Qt::green));
+            painter.setRenderHint(QPainter::Antialiasing, true);
+            scene.Draw(&painter);
+        };
+
+        auto fitScale = std::min(FrameSize.width(), FrameSize.height()) / side;
+        auto fitLevel = static_cast<int>(std::floor(std::log(fitScale) / std::log(1.05)));
+        struct Zoom { const char* name; int level; };
+        const Zoom zooms[] = { { "fit", fitLevel }, { "1:1", 0 }, { "4:1", 28 } };
+
+        struct Mode { const char* name; bool batched; bool lod; bool threaded; };
+        const Mode modes[] = { { "direct", false, false, false }, { "lod", false, true, false },
+            { "lod_batched", true, true, false }, { "lod_batched_threaded", true, true, true } };
+
+        QJsonArray paints;
+        auto lodPolicy = drawableActor->GetLodPolicy();
+        for (auto const& mode : modes)
+        {
+            lodPolicy.enabled = mode.lod;
+            drawableActor->SetLodPolicy(lodPolicy);
+            scene.SetBatchedDrawing(mode.batched);
+            scene.SetThreadedDrawing(mode.threaded);
+            for (auto const& zoom : zooms)
+            {
+                for (auto selected : { false, true })
+                {
+                    scene.SetView(centre, zoom.level);
+                    SetSelected(shapes, selected);
+
+                    auto timing = Measure(frames, paint);
+                    auto stats = scene.LastDrawStats();
+                    timing["zoom"] = zoom.name;
+                    timing["selection"] = selected ? "all" : "none";
+                    timing["mode"] = mode.name;
+                    timing["drawn"] = stats.drawn;
+                    timing["culled"] = stats.culled;
+                    timing["batches"] = stats.batches;
+                    timing["lod"] = QJsonObject{
+                        { "full", stats.lodFull },
+                        { "greeked", stats.lodGreeked },
+                        { "points", stats.lodPoints },
+                        { "skipped", stats.lodSkipped },
+                        { "handles_skipped", stats.lodHandlesSkipped },
+                    };
+                    paints.append(timing);
+                }
+            }
+        }
+        result["paint"] = paints;
+        lodPolicy.enabled = true;
+        drawableActor->SetLodPolicy(lodPolicy);
+        scene.SetBatchedDrawing(false);
+        scene.SetThreadedDrawing(false);
+        SetSelected(shapes, false);
+        scene.SetView(centre, 0);
+
+        // pick
+        QRandomGenerator random(2);
+        std::vector<QPointF> positions(1000);
+        for (auto& pos : positions)
+            pos = QPointF(random.bounded(side), random.bounded(side));
+
+        auto grabTiming = Measure(frames, [&]()
+            {
+                for (auto const& pos : positions)
+                    movableActor->GrabOn(pos);
+            });
+        movableActor->ReleaseAll();
+        grabTiming["picks_per_run"] = static_cast<int>(positions.size());
+        result["pick_grab"] = grabTiming;
+
+        auto selectTiming = Measure(frames, [&]()
+            {
+                for (auto const& pos : positions)
+                    drawableActor->SelectOn(pos);
+            });
+        selectTiming["picks_per_run"] = static_cast<int>(positions.size());
+        result["pick_select"] = selectTiming;
+
+        // refresh: the z-order changes that used to re-sort every shape
+        drawableActor->UnSelectAll();
+        auto target = shapes[shapes.size() / 2];
+        target->GetModel()->SetSelected(true);
+        result["refresh"] = Measure(frames, [&]()
+            {
+                drawableActor->BringSelectedToFront();
+                drawableActor->SendSelectedToBack();
+            });
+
+        // a tenth of the shapes selected, moved and re-ordered as one batch
+        drawableActor->UnSelectAll();
+        for (size_t i = 0; i < shapes.size(); i += 10)
+            shapes[i]->GetModel()->SetSelected(true);
+
+        auto sign = 1.f;
+        auto moveTiming = Measure(frames, [&]()
+            {
+                drawableActor->MoveSelected(QVector2D(sign, sign));
+                sign = -sign;
+            });
+        moveTiming["selected"] = static_cast<int>(drawableActor->Selection().Size());
+        result["move_selection"] = moveTiming;
+        result["reorder_selection"] = Measure(frames, [&]()
+            {
+                drawableActor->BringSelectedToFront();
+                drawableActor->SendSelectedToBack();
+            });
+
+        // a hundred steps of one grab make one entry, undone and redone as one
+        auto undoStack = scene.GetUndoStack();
+        undoStack->Clear();
+        undoStack->BeginGrab();
+        for (auto i = 0; i < 100; ++i)
+            drawableActor->MoveSelected(QVector2D(1.f, 0.f));
+        undoStack->EndGrab();
+
+        QJsonObject undo;
+        undo["grab_entries"] = undoStack->GetStats().undoable;
+        undo["grab_bytes"] = qint64(undoStack->GetStats().bytes);
+        undo["undo_redo_move"] = Measure(frames, [&]() { undoStack->Undo(); undoStack->Redo(); });
+        drawableActor->DeletSelected();
+        undo["undo_delete"] = Measure(1, [&]() { undoStack->Undo(); });
+        undo["restored"] = static_cast<int>(drawableActor->Selection().Size());
+        result["undo"] = undo;
+
+        // drag a rect corner, the shape is brought to the front so the grab hits it
+        drawableActor->UnSelectAll();
+        auto rect = std::static_pointer_cast<IntRect>(shapes[shapes.size() / 2 / 4 * 4]->GetModel());
+        rect->SetSelected(true);
+        drawableActor->BringSelectedToFront();
+        scene.SetView(rect->GetPosition().toPointF(), 0);
+
+        auto start = rect->m_nodeC->GetPosition().toPointF();
+        auto step = 0;
+        auto dragTo = [&]()
+        {
+            ++step;
+            auto offset = QPointF(std::sin(step * .1) * 30., std::cos(step * .1) * 30.);
+            movableActor->SetExpectedToGrabbed(start + offset);
+        };
+
+        movableActor->GrabOn(start);
+        result["drag_step"] = Measure(steps, dragTo);
+        result["drag_frame"] = Measure(steps, [&]() { dragTo(); paint(); });
+        movableActor->ReleaseAll();
+
+        return result;
+    }
+
+    // adds the cost of one kernel call to a Measure summary
+    QJsonObject PerOp(QJsonObject timing, int opsPerRun)
+    {
+        timing["ops_per_run"] = opsPerRun;
+        timing["median_ns_per_op"] = timing["median_ms"].toDouble() * 1e6 / opsPerRun;
+        return timing;
+    }
+
+    // a 100x60 rect turned by its rotate handle, so the handlers do not take the axis aligned case
+    std::shared_ptr<IntRect> RotatedRect()
+    {
+        auto rect = DrawablesInit::InitRect(QRectF(0., 0., 100., 60.))->m_rect;
+        rect->m_nodeR->GrabOn(rect->m_nodeR->GetPosition().toPointF());
+        rect->m_nodeR->SetExpectedPosition(QPointF(-20., -60.));
+        return rect;
+    }
+
+    // drags one handle of a rotated rect around a circle, one move handler call per step
+    QJsonObject RectHandle(std::shared_ptr<Node> IntRect::* handle, int frames, int iterations)
+    {
+        auto rect = RotatedRect();
+
+        auto node = ((*rect).*handle).get();
+        auto centre = rect->GetPosition().toPointF();
+        auto start = node->GetPosition().toPointF();
+        auto radius = handle == &IntRect::m_nodeR ? QLineF(centre, start).length() : 20.;
+        auto around = handle == &IntRect::m_nodeR ? centre : start;
+        node->GrabOn(start);
+
+        auto step = 0;
+        return PerOp(Measure(frames, [&]()
+            {
+                for (auto i = 0; i < iterations; ++i, ++step)
+                {
+                    auto angle = step * .05;
+                    node->SetExpectedPosition(around + radius * QPointF(std::cos(angle), std::sin(angle)));
+                }
+            }), iterations);
+    }
+
+    // a node following the drag, reached through the Moved signal or a direct constraint
+    QJsonObject Dispatch(bool direct, int frames, int iterations)
+    {
+        Node node(QPointF(0., 0.));
+        auto follow = [&node](QPointF const&, QPointF const& toPos) { node.SetPosition(toPos); };
+        if (direct)
+            node.SetConstraint(&node, follow);
+        else
+            QObject::connect(&node, &Movable::Moved, follow);
+
+        auto step = 0;
+        return PerOp(Measure(frames, [&]()
+            {
+                for (auto i = 0; i < iterations; ++i, ++step)
+                    node.SetExpectedPosition(QPointF(step % 2, 0.));
+            }), iterations);
+    }
+
+    // hit tests random points spread over the shape bounds and a margin around them
+    QJsonObject PointOn(NodeModel const& model, int frames, int iterations)
+    {
+        QRandomGenerator random(3);
+        auto bounds = model.Bounds().adjusted(-20., -20., 20., 20.);
+        std::vector<QPointF> points(1024);
+        for (auto& point : points)
+            point = bounds.topLeft() + QPointF(random.bounded(bounds.width()), random.bounded(bounds.height()));
+
+        auto hits = 0;
+        auto timing = PerOp(Measure(frames, [&]()
+            {
+                for (auto i = 0; i < iterations; ++i)
+                    hits += model.IsPointOn(points[i & 1023]) ? 1 : 0;
+            }), iterations);
+        timing["hit_ratio"] = double(hits) / (double(frames) * iterations);
+        return timing;
+    }
+
+    // the bounds of a shape over its nodes in the NodeStore, as culling and picking update them
+    QJsonObject ModelBounds(NodeModel const& model, int frames, int iterations)
+    {
+        QRectF bounds;
+        auto timing = PerOp(Measure(frames, [&]()
+            {
+                for (auto i = 0; i < iterations; ++i)
+                    bounds |= model.Bounds();
+            }), iterations);
+        timing["width"] = bounds.width();
+        return timing;
+    }
+
+    // brings single shapes of a scene to the front and back again through both actors
+    QJsonObject ZOrder(int count, int frames, int iterations)
+    {
+        auto movableActor = std::make_shared<MovableActor>();
+        DrawableActor drawableActor(movableActor, []() {}, [](QRectF const&, QRectF const&) {});
+
+        auto shapes = SyntheticScene::Generate(count);
+        for (auto const& shape : shapes)
+            drawableActor.Add(shape);
+
+        size_t step = 0;
+        auto timing = PerOp(Measure(frames, [&]()
+            {
+                for (auto i = 0; i < iterations; ++i, ++step)
+                {
+                    auto model = shapes[(step * 7919) % shapes.size()]->GetModel();
+                    model->SetSelected(true);
+                    drawableActor.BringSelectedToFront();
+                    drawableActor.SendSelectedToBack();
+                    model->SetSelected(false);
+                }
+            }), iterations);
+        timing["shapes"] = count;
+        return timing;
+    }
+
+    QJsonObject RunKernels(int frames, int iterations)
+    {
+        auto rect = RotatedRect();
+
+        auto line = std::static_pointer_cast<IntVector>(
+            DrawablesInit::InitLine(QPointF(0., 0.), QPointF(100., 60.))->GetModel());
+
+        return QJsonObject{
+            { "rect_corner_a", RectHandle(&IntRect::m_nodeA, frames, iterations) },
+            { "rect_corner_b", RectHandle(&IntRect::m_nodeB, frames, iterations) },
+            { "rect_corner_c", RectHandle(&IntRect::m_nodeC, frames, iterations) },
+            { "rect_corner_d", RectHandle(&IntRect::m_nodeD, frames, iterations) },
+            { "rect_rotate", RectHandle(&IntRect::m_nodeR, frames, iterations) },
+            { "dispatch_signal", Dispatch(false, frames, iterations) },
+            { "dispatch_direct", Dispatch(true, frames, iterations) },
+            { "rect_point_on", PointOn(*rect, frames, iterations) },
+            { "vector_point_on", PointOn(*line, frames, iterations) },
+            { "rect_bounds", ModelBounds(*rect, frames, iterations) },
+            { "z_order_10k", ZOrder(10000, frames, iterations / 100) },
+        };
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QApplication::setApplicationName("interactive_drawing_bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures paint, pick, refresh and drag timings on synthetic scenes.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated shape counts.", "counts", "1000,10000,100000");
+    QCommandLineOption framesOption("frames", "Repeats per paint/pick/refresh phase.", "count", "10");
+    QCommandLineOption stepsOption("steps", "Drag steps.", "count", "200");
+    QCommandLineOption outputOption("output", "Write the JSON to a file instead of stdout.", "file");
+    QCommandLineOption kernelsOption("kernels", "Time the move handlers, hit tests and z-order changes instead.");
+    QCommandLineOption iterationsOption("iterations", "Kernel calls per run.", "count", "100000");
+    QCommandLineOption pageBudgetOption("page-budget", "Memory budget of the paged scene in MB.", "mb", "64");
+    parser.addOptions({ sizesOption, framesOption, stepsOption, outputOption, kernelsOption, iterationsOption,
+        pageBudgetOption });
+    parser.process(app);
+
+    auto frames = std::max(1, parser.value(framesOption).toInt());
+    auto steps = std::max(1, parser.value(stepsOption).toInt());
+    auto iterations = std::max(100, parser.value(iterationsOption).toInt());
+    auto pageBudget = size_t(std::max(1, parser.value(pageBudgetOption).toInt())) << 20;
+
+    QJsonObject report;
+    if (parser.isSet(kernelsOption))
+    {
+        report["kernels"] = RunKernels(frames, iterations);
+    }
+    else
+    {
+        QJsonArray scenes;
+        for (auto const& size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts))
+            scenes.append(RunScene(size.toInt(), frames, steps, pageBudget));
+
+        report["frame"] = QJsonArray{ FrameSize.width(), FrameSize.height() };
+        report["scenes"] = scenes;
+    }
+    auto json = QJsonDocument(report).toJson();
+
+    if (!parser.isSet(outputOption))
+    {
+        QTextStream(stdout) << json;
+        return 0;
+    }
+
+    QFile file(parser.value(outputOption));
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qCritical() << "cannot write" << file.fileName();
+        return 1;
+    }
+    file.write(json);
+    return 0;
+}
@@ -45,10 +45,7 @@ static class DrawablesContextMenu
 
         QAction deleteSelected("Delete", parent);
         QObject::connect(&deleteSelected, &QAction::triggered,
-            [=]() {
-                drawableActor->DeletSelected();
-                textActor->DeleteSelected();
-            });
+            [=]() { drawableActor->DeletSelected(); });
 
         contextMenu.addAction(&deleteSelected);
         contextMenu.exec(parent->mapToGlobal(pos));
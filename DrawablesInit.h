@@ -3,50 +3,84 @@
 #include <memory>
 
 #include "drawables.h"
+#include "ShapeArena.h"
 
+// the shapes come from the ShapeArena of the open ShapeArena::Scope, if there is one
 static class DrawablesInit
 {
     public:
     inline static std::shared_ptr<RectRep> InitRect(QPointF const& pos)
     {
-        auto rect = std::make_shared<IntRect>(QRect(pos.x(), pos.y(), 1.0, 1.0));
-        auto rectRep = std::make_shared<RectRep>(rect);
-        rect->m_nodeC->GrabOn(pos);
+        auto rectRep = InitRect(QRectF(QRect(pos.x(), pos.y(), 1.0, 1.0)));
+        rectRep->m_rect->m_nodeC->GrabOn(pos);
         return rectRep;
     }
 
+    inline static std::shared_ptr<RectRep> InitRect(QRectF const& rect)
+    {
+        return ShapeArena::Make<RectRep>(ShapeArena::Make<IntRect>(rect));
+    }
+
+    // a rect as IntRect keeps it, with the corners around the centre
+    inline static std::shared_ptr<RectRep> InitRect(QVector2D const& centre,
+        QVector2D const& diaVecA, QVector2D const& diaVecB)
+    {
+        return ShapeArena::Make<RectRep>(ShapeArena::Make<IntRect>(centre, diaVecA, diaVecB));
+    }
+
     inline static std::shared_ptr<EllipseRep> InitEllipse(QPointF const& pos)
     {
-        auto rect = std::make_shared<IntRect>(QRect(pos.x(), pos.y(), 1.0, 1.0));
-        auto rectRep = std::make_shared<EllipseRep>(rect);
-        rect->m_nodeC->GrabOn(pos);
-        return rectRep;
+        auto ellipseRep = InitEllipse(QRectF(QRect(pos.x(), pos.y(), 1.0, 1.0)));
+        ellipseRep->m_rect->m_nodeC->GrabOn(pos);
+        return ellipseRep;
+    }
+
+    inline static std::shared_ptr<EllipseRep> InitEllipse(QRectF const& rect)
+    {
+        return ShapeArena::Make<EllipseRep>(ShapeArena::Make<IntRect>(rect));
+    }
+
+    inline static std::shared_ptr<EllipseRep> InitEllipse(QVector2D const& centre,
+        QVector2D const& diaVecA, QVector2D const& diaVecB)
+    {
+        return ShapeArena::Make<EllipseRep>(ShapeArena::Make<IntRect>(centre, diaVecA, diaVecB));
     }
 
     inline static std::shared_ptr<VectorRep> InitLine(QPointF const& pos)
     {
-        auto line = std::make_shared<IntVector>(
-            std::make_shared<Node>(pos), std::make_shared<Node>(pos));
+        auto lineRep = InitLine(pos, pos);
+        std::static_pointer_cast<IntVector>(lineRep->GetModel())->m_nodeB->GrabOn(pos);
+        return lineRep;
+    }
+
+    inline static std::shared_ptr<VectorRep> InitLine(QPointF const& from, QPointF const& to)
+    {
+        auto line = ShapeArena::Make<IntVector>(
+            ShapeArena::Make<Node>(from), ShapeArena::Make<Node>(to));
 
         line->FreeVector();
-        auto lineRep = std::make_shared<VectorRep>(line);
-        line->m_nodeB->GrabOn(pos);
-        return lineRep;
+        return ShapeArena::Make<VectorRep>(line);
     }
 
     inline static std::shared_ptr<IntNodeRep> InitNode(QPointF const& pos)
     {
-        auto node = std::make_shared<IntNode>(std::make_shared<Node>(pos));
+        auto node = ShapeArena::Make<IntNode>(ShapeArena::Make<Node>(pos));
         node->SetParentToNodes(node);
         node->Free();
-        auto nodeRep = std::make_shared<IntNodeRep>(node);
+        auto nodeRep = ShapeArena::Make<IntNodeRep>(node);
         return nodeRep;
     }
 
     inline static std::shared_ptr<TextRep> InitText(QPointF const& pos, QString const& txt)
     {
-        auto text = std::make_shared<TextRep>(txt,
-            std::make_shared<IntRect>(QRectF(pos, QSizeF(160, 80))));
+        auto text = ShapeArena::Make<TextRep>(txt,
+            ShapeArena::Make<IntRect>(QRectF(pos, QSizeF(160, 80))));
         return text;
     }
+
+    inline static std::shared_ptr<TextRep> InitText(QString const& txt, QVector2D const& centre,
+        QVector2D const& diaVecA, QVector2D const& diaVecB)
+    {
+        return ShapeArena::Make<TextRep>(txt, ShapeArena::Make<IntRect>(centre, diaVecA, diaVecB));
+    }
 };
@@ -1,3 +1,6 @@
+#include <atomic>
+#include <cmath>
+
 #include <QApplication>
 #include <QMenu>
 #include <QResizeEvent>
@@ -5,6 +8,8 @@
 #include "drawablesscene.h"
 #include "DrawablesContextMenu.h"
 #include "DrawablesInit.h"
+#include "SceneFile.h"
+#include "SceneImporter.h"
 
 
 DrawablesScene::DrawablesScene(QWidget* parent): m_parent(parent), Movable(QVector2D(0, 0))
@@ -13,13 +18,28 @@ DrawablesScene::DrawablesScene(QWidget* parent): m_parent(parent), Movable(QVect
         {
             if (m_sceneAction == SceneAction::Pan)
             {
+                auto fromOrigin = m_sceneMapper->MapFromScene(QPointF(0., 0.));
                 SetPosition(GetPosition() + (QVector2D(toPos - fromPos) / m_scale));
                 SetStartPos(QVector2D(toPos));
+                updateView();
+
+                // at a fixed zoom a pan is a whole pixel shift of the frame, unless
+                // the scale lets the division above drift off the pixel grid
+                auto shift = m_sceneMapper->MapFromScene(QPointF(0., 0.)) - fromOrigin;
+                auto pixels = shift.toPoint();
+                if (std::abs(shift.x() - pixels.x()) < 1e-3 && std::abs(shift.y() - pixels.y()) < 1e-3)
+                {
+                    emit Scrolled(pixels);
+                    return;
+                }
             }
             if (m_sceneAction == SceneAction::Zoom)
             {
-                m_scale *= (QVector2D(toPos - fromPos).y() < 0)? 1.05 : (1./1.05);
+                auto zoomIn = QVector2D(toPos - fromPos).y() < 0;
+                m_scale *= zoomIn ? 1.05 : (1./1.05);
+                m_zoomLevel += zoomIn ? 1 : -1;
                 SetStartPos(QVector2D(toPos));
+                updateView();
             }
             if (m_sceneAction == SceneAction::Rotate)
             {
@@ -31,13 +51,22 @@ DrawablesScene::DrawablesScene(QWidget* parent): m_parent(parent), Movable(QVect
 
     auto floatText = new QTextEdit(m_parent);
     floatText->hide();
-    m_textActor = std::make_shared<TextActor>(floatText, m_sceneMapper);
+    m_drawableActor->SetUndoStack(m_undoStack);
+    // shapes brought back by undo and redo are paged like new ones
+    m_undoStack->SetInsertHandler([this](NodeModelRepPtr const& shape)
+        {
+            m_drawableActor->Insert(shape);
+            if (m_pagedScene != nullptr)
+                m_pagedScene->Adopt(shape);
+        });
+    m_textActor = std::make_shared<TextActor>(floatText, m_sceneMapper, m_drawableActor);
     connect(m_textActor.get(), &TextActor::TextCreated,
-        this, [=](NodeModelRepPtr nmRep) {m_drawableActor->Add(nmRep); });
+        this, [=](NodeModelRepPtr nmRep) { addShape(nmRep); });
 }
 
 DrawablesScene::NodeModelRepPtr DrawablesScene::CreateShape(Shape shape, QPointF const& startPos)
 {
+    ShapeArena::Scope scope(m_arena);
     switch (shape)
     {
     case Shape::Rect:
@@ -59,6 +88,19 @@ DrawablesScene::NodeModelRepPtr DrawablesScene::CreateShape(Shape shape, QPointF
 }
 
 
+DrawablesScene::FreezeScope::FreezeScope(DrawablesScene& scene, QRectF const& rect) : m_scene(scene)
+{
+    if (m_scene.m_frozen++ == 0 && m_scene.m_pagedScene != nullptr)
+        m_scene.m_pagedScene->PageIn(rect);
+}
+
+DrawablesScene::FreezeScope::~FreezeScope()
+{
+    // paging catches up with the view, and back to the budget
+    if (--m_scene.m_frozen == 0)
+        m_scene.updateView();
+}
+
 bool DrawablesScene::IsPointOn(const QPointF& pos) const
 {
     return true;
@@ -66,6 +108,9 @@ bool DrawablesScene::IsPointOn(const QPointF& pos) const
 
 void DrawablesScene::MouseMoveHandler(QMouseEvent* ev)
 {
+    if (m_frozen > 0)
+        return;
+
     auto btn = ev->buttons();
     auto pos = ev->pos();
 
@@ -80,11 +125,25 @@ void DrawablesScene::MouseMoveHandler(QMouseEvent* ev)
         return;
 
     auto mappedPos = m_sceneMapper->MapToScene(pos);
+    if (!dragsSelection())
+    {
+        m_movableActor->SetExpectedToGrabbed(mappedPos);
+        return;
+    }
+
+    // the rest of the selection follows the grabbed model, all in one repaint
+    DrawableActor::UpdateScope scope(*m_drawableActor);
+    auto grabbed = m_movableActor->GrabbedModel();
+    auto fromPos = grabbed->GetPosition();
     m_movableActor->SetExpectedToGrabbed(mappedPos);
+    m_drawableActor->MoveSelected(grabbed->GetPosition() - fromPos, grabbed);
 }
 
 void DrawablesScene::MousePressedHandler(QMouseEvent* ev)
 {
+    if (m_frozen > 0)
+        return;
+
     auto btn = ev->buttons();
     auto pos = ev->pos();
     auto mod = ev->modifiers();
@@ -104,18 +163,34 @@ void DrawablesScene::MousePressedHandler(QMouseEvent* ev)
     if (btn != Qt::RightButton)
         return;
 
-    m_drawableActor->UnSelectAll();
+    // everything the press and the drag after it do is undone in one step; the
+    // context menu eats the release, what it does is recorded by itself
+    auto contextMenu = m_currentShape == Shape::None && mod == Qt::KeyboardModifier::ControlModifier;
+    if (!contextMenu)
+        m_undoStack->BeginGrab();
+
+    // a press on a selected shape keeps the selection to drag it, shift adds to it
     auto mappedPos = m_sceneMapper->MapToScene(pos);
+    auto onSelected = [&]()
+        {
+            auto model = m_drawableActor->ModelOn(mappedPos);
+            return model != nullptr && model->IsSelected();
+        };
+    if (m_currentShape != Shape::None || (mod != Qt::KeyboardModifier::ShiftModifier && !onSelected()))
+        m_drawableActor->UnSelectAll();
 
     if (m_currentShape == Shape::None)
     {
         m_movableActor->GrabOn(mappedPos);
-
-        if (mod == Qt::KeyboardModifier::ControlModifier)
+        if (!contextMenu)
         {
-            DrawablesContextMenu::Show(pos, m_drawableActor, m_textActor, m_parent);
+            keepGrabStart();
+            return;
         }
 
+        DrawablesContextMenu::Show(pos, m_drawableActor, m_textActor, m_parent);
+        m_grabStart.reset();
+        m_undoStack->EndGrab();
         return;
     }
 
@@ -127,7 +202,8 @@ void DrawablesScene::MousePressedHandler(QMouseEvent* ev)
     auto drawable = CreateShape(m_currentShape, mappedPos);
     if (drawable != nullptr)
     {
-        m_drawableActor->Add(drawable);
+        addShape(drawable);
+        keepGrabStart();
     }
 
     m_currentShape = Shape::None; // TODO: keep drawing or not..
@@ -135,7 +211,15 @@ void DrawablesScene::MousePressedHandler(QMouseEvent* ev)
 
 void DrawablesScene::MouseReleasedHandler(QMouseEvent* ev)
 {
+    if (m_grabStart)
+    {
+        m_undoStack->RecordGeometry(m_grabStart->shape, m_grabStart->geometry);
+        m_grabStart.reset();
+    }
+    m_undoStack->EndGrab();
+
     m_movableActor->ReleaseAll();
+    m_dragLayers.reset();
     Released();
     m_sceneAction = SceneAction::None;
 }
@@ -144,6 +228,7 @@ void DrawablesScene::ResizeHandler(QResizeEvent* event)
 {
     auto newSize = event->size();
     m_frameCentre = QPointF(newSize.width(), newSize.height()) / 2.;
+    updateView();
 }
 
 void DrawablesScene::SetCurrentShape(Shape action)
@@ -153,20 +238,416 @@ void DrawablesScene::SetCurrentShape(Shape action)
 
 void DrawablesScene::Draw(QPainter* painter)
 {
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    QElapsedTimer timer;
+    timer.start();
+    draw(painter);
+    m_frameTimes.Add(timer.nsecsElapsed());
+
+    auto changes = m_drawableActor->GetCounters().changes;
+    m_changesPerFrame = changes - m_changesAtFrame;
+    m_changesAtFrame = changes;
+#else
+    draw(painter);
+#endif
+}
+
+void DrawablesScene::draw(QPainter* painter)
+{
+    auto grabbed = m_movableActor->GrabbedModel();
+    if (grabbed != nullptr && !dragsSelection() && drawDragLayers(painter, grabbed))
+        return;
+
+    if (m_tileCacheEnabled)
+    {
+        drawTiles(painter);
+        return;
+    }
+
+    if (m_threadedDrawing)
+    {
+        drawThreaded(painter);
+        return;
+    }
+
     painter->save();
-    painter->translate(m_frameCentre);
-    painter->scale(m_scale, m_scale);
-    painter->translate(GetPosition().toPointF());
-    m_sceneMapper->SetTransform(painter->transform());
-    m_drawableActor->DrawAll(painter);
+    painter->setTransform(m_sceneMapper->Transform(), true);
+
+    // one pixel of slack for the antialiased outlines
+    auto visibleRect = painter->hasClipping() ? painter->clipBoundingRect()
+        : m_sceneMapper->MapRectToScene(QRectF(painter->viewport()).adjusted(-1, -1, 1, 1));
+    m_lastDrawStats = m_drawableActor->DrawAll(painter, visibleRect);
     painter->restore();
 }
 
+DrawablesScene::DrawStats DrawablesScene::LastDrawStats() const
+{
+    return m_lastDrawStats;
+}
+
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+DrawablesScene::PerfStats DrawablesScene::GetPerfStats() const
+{
+    auto counters = m_drawableActor->GetCounters();
+    PerfStats stats;
+    stats.frameMs = m_frameTimes.Last() / 1e6;
+    stats.p50Ms = m_frameTimes.Percentile(.5) / 1e6;
+    stats.p99Ms = m_frameTimes.Percentile(.99) / 1e6;
+    stats.drawn = m_lastDrawStats.drawn;
+    stats.shapes = counters.shapes;
+    stats.pickMs = m_movableActor->LastPickNs() / 1e6;
+    stats.sortMs = counters.sortNs / 1e6;
+    stats.refreshMs = counters.refreshNs / 1e6;
+    stats.changesPerFrame = m_changesPerFrame;
+    return stats;
+}
+#endif
+
+void DrawablesScene::SetTileCacheEnabled(bool enabled)
+{
+    m_tileCacheEnabled = enabled;
+    m_tileCache.Clear();
+    emit Updated();
+}
+
+void DrawablesScene::SetBatchedDrawing(bool enabled)
+{
+    m_drawableActor->SetBatched(enabled);
+}
+
+void DrawablesScene::SetThreadedDrawing(bool enabled)
+{
+    m_threadedDrawing = enabled;
+    emit Updated();
+}
+
+void DrawablesScene::SetView(QPointF const& centre, int zoomLevel)
+{
+    SetPosition(-centre);
+    m_zoomLevel = zoomLevel;
+    m_scale = std::pow(1.05, zoomLevel);
+    updateView();
+    emit Updated();
+}
+
+void DrawablesScene::Clear()
+{
+    m_pagedScene.reset();
+    m_movableActor->ReleaseAll();
+    m_dragLayers.reset();
+    m_drawableActor->Clear();
+    m_undoStack->Clear();
+    m_arena = std::make_shared<ShapeArena>();
+}
+
+bool DrawablesScene::Save(QString const& fileName, QString* error) const
+{
+    return SceneFile::Save(fileName, m_drawableActor->GetDrawables(), error);
+}
+
+bool DrawablesScene::Load(QString const& fileName, QString* error)
+{
+    // the loaded shapes get an arena of their own, it replaces the current one
+    auto arena = std::make_shared<ShapeArena>();
+    std::optional<std::vector<NodeModelRepPtr>> shapes;
+    {
+        ShapeArena::Scope scope(arena);
+        shapes = SceneFile::Load(fileName, error);
+    }
+    if (!shapes)
+        return false;
+
+    Clear();
+    m_arena = arena;
+    m_drawableActor->AddAll(*shapes);
+    return true;
+}
+
+bool DrawablesScene::Import(QString const& fileName, QString* error)
+{
+    auto records = SceneImporter::Read(fileName, error);
+    if (!records)
+        return false;
+
+    std::vector<NodeModelRepPtr> shapes;
+    {
+        ShapeArena::Scope scope(m_arena);
+        shapes = SceneImporter::Build(*records);
+    }
+
+    m_drawableActor->AddAll(shapes);
+    m_undoStack->RecordInsert(shapes);
+    if (m_pagedScene != nullptr)
+    {
+        for (auto const& shape : shapes)
+            m_pagedScene->Adopt(shape);
+    }
+    return true;
+}
+
+bool DrawablesScene::SavePaged(QString const& directory, QString* error) const
+{
+    return PagedScene::Build(directory, m_drawableActor->GetDrawables(), PagedScene::DefaultChunkSize, error);
+}
+
+bool DrawablesScene::OpenPaged(QString const& directory, QString* error)
+{
+    auto pagedScene = std::make_unique<PagedScene>(m_drawableActor);
+    if (!pagedScene->Open(directory, error))
+        return false;
+
+    Clear();
+    m_pagedScene = std::move(pagedScene);
+    // the history must not keep shapes of paged out chunks, nor edit copies of them
+    m_pagedScene->SetEvictionHandler([this]() { m_undoStack->Clear(); });
+    updateView();
+    return true;
+}
+
+PagedScene* DrawablesScene::GetPagedScene() const
+{
+    return m_pagedScene.get();
+}
+
+QRectF DrawablesScene::SceneBounds() const
+{
+    auto bounds = m_drawableActor->SceneBounds();
+    if (m_pagedScene != nullptr)
+        bounds |= m_pagedScene->Bounds();
+    return bounds;
+}
+
+std::shared_ptr<ShapeArena> DrawablesScene::GetArena() const
+{
+    return m_arena;
+}
+
+std::shared_ptr<DrawableActor> DrawablesScene::GetDrawableActor() const
+{
+    return m_drawableActor;
+}
+
+std::shared_ptr<UndoStack> DrawablesScene::GetUndoStack() const
+{
+    return m_undoStack;
+}
+
+std::shared_ptr<MovableActor> DrawablesScene::GetMovableActor() const
+{
+    return m_movableActor;
+}
+
+void DrawablesScene::updateRegion(QRectF const& oldBounds, QRectF const& newBounds)
+{
+    m_tileCache.Invalidate(oldBounds);
+    m_tileCache.Invalidate(newBounds);
+
+    QRectF const bounds[] = { oldBounds, newBounds };
+    QRectF mapped[2];
+    m_sceneMapper->MapRectsFromScene(bounds, mapped);
+
+    // the outlines are antialiased, so a couple of pixels are added around the shapes
+    QRegion region;
+    for (auto i = 0; i < 2; ++i)
+    {
+        if (bounds[i].isNull())
+            continue;
+        region += mapped[i].toAlignedRect().adjusted(-2, -2, 2, 2);
+    }
+
+    if (!region.isEmpty())
+        emit RegionUpdated(region);
+}
+
 void DrawablesScene::KeyPressedHandler(QKeyEvent* ev)
 {
+    if (m_frozen > 0)
+        return;
+
+    if (ev->matches(QKeySequence::Undo))
+    {
+        m_undoStack->Undo();
+        return;
+    }
+
+    if (ev->matches(QKeySequence::Redo))
+    {
+        m_undoStack->Redo();
+        return;
+    }
+
     if (ev->key() == Qt::Key_Delete)
     {
-        m_textActor->DeleteSelected();
         m_drawableActor->DeletSelected();
+        return;
+    }
+
+    // the arrows nudge the selection by a pixel, by ten with shift
+    auto step = (ev->modifiers() & Qt::KeyboardModifier::ShiftModifier ? 10. : 1.) / m_scale;
+    switch (ev->key())
+    {
+    case Qt::Key_Left:
+        m_drawableActor->MoveSelected(QVector2D(-step, 0.));
+        break;
+    case Qt::Key_Right:
+        m_drawableActor->MoveSelected(QVector2D(step, 0.));
+        break;
+    case Qt::Key_Up:
+        m_drawableActor->MoveSelected(QVector2D(0., -step));
+        break;
+    case Qt::Key_Down:
+        m_drawableActor->MoveSelected(QVector2D(0., step));
+        break;
+    default:
+        break;
+    }
+}
+
+bool DrawablesScene::dragsSelection() const
+{
+    auto grabbed = m_movableActor->GrabbedModel();
+    return grabbed != nullptr && m_movableActor->Grabbed() == grabbed &&
+        grabbed->IsGrabbed() && m_drawableActor->Selection().Size() > 1;
+}
+
+void DrawablesScene::drawTiles(QPainter* painter)
+{
+    auto style = PaintStyle::Of(painter);
+    m_tileCache.SetStyle(style);
+
+    auto deviceRect = painter->hasClipping() ?
+        painter->clipBoundingRect().toAlignedRect() : painter->viewport();
+
+    // the tiles are composited on whole pixels
+    auto origin = (m_frameCentre + m_scale * GetPosition().toPointF()).toPoint();
+    auto scale = m_scale;
+
+    m_lastDrawStats = DrawStats();
+    m_tileCache.Draw(painter, deviceRect, origin, m_zoomLevel, scale,
+        [=](QRect const& zoomedRect, qreal devicePixelRatio)
+        {
+            DrawStats tileStats;
+            auto tile = SceneRasterizer::RenderTile(*m_drawableActor, zoomedRect,
+                QTransform::fromScale(scale, scale), style, &tileStats, devicePixelRatio);
+            m_lastDrawStats += tileStats;
+            return tile;
+        });
+}
+
+bool DrawablesScene::drawDragLayers(QPainter* painter, NodeModel* grabbed)
+{
+    auto style = PaintStyle::Of(painter);
+    auto const& transform = m_sceneMapper->Transform();
+
+    if (!m_dragLayers || m_dragLayers->model != grabbed ||
+        m_dragLayers->viewVersion != m_sceneMapper->Version() || m_dragLayers->style != style)
+    {
+        auto active = m_drawableActor->FindRep(grabbed);
+        if (active == nullptr)
+            return false;
+
+        auto frame = painter->viewport();
+        auto ratio = painter->device()->devicePixelRatioF();
+        auto z = grabbed->GetZOrder();
+
+        DragLayers layers;
+        layers.model = grabbed;
+        layers.active = active;
+        layers.viewVersion = m_sceneMapper->Version();
+        layers.style = style;
+        layers.below = SceneRasterizer::RenderTile(*m_drawableActor, frame, transform, style,
+            nullptr, ratio, -std::numeric_limits<double>::infinity(), z);
+        layers.above = SceneRasterizer::RenderTile(*m_drawableActor, frame, transform, style,
+            nullptr, ratio, z, std::numeric_limits<double>::infinity());
+        m_dragLayers = std::move(layers);
     }
+
+    painter->drawImage(QPointF(0., 0.), m_dragLayers->below);
+
+    painter->save();
+    painter->setTransform(transform, true);
+    m_dragLayers->active->Draw(painter);
+    painter->restore();
+
+    painter->drawImage(QPointF(0., 0.), m_dragLayers->above);
+
+    m_lastDrawStats = DrawStats();
+    m_lastDrawStats.drawn = 1;
+    return true;
+}
+
+// the shapes are only read while the GUI thread waits for the tiles, so the
+// workers need no locking; the GUI thread renders tiles too
+void DrawablesScene::drawThreaded(QPainter* painter)
+{
+    constexpr int TileSize = 256;
+
+    auto style = PaintStyle::Of(painter);
+    auto const& transform = m_sceneMapper->Transform();
+    auto ratio = painter->device()->devicePixelRatioF();
+    auto deviceRect = painter->hasClipping() ?
+        painter->clipBoundingRect().toAlignedRect() : painter->viewport();
+
+    std::vector<QRect> rects;
+    for (auto y = deviceRect.top(); y <= deviceRect.bottom(); y += TileSize)
+    {
+        for (auto x = deviceRect.left(); x <= deviceRect.right(); x += TileSize)
+            rects.push_back(QRect(x, y, TileSize, TileSize) & deviceRect);
+    }
+
+    std::vector<QImage> tiles(rects.size());
+    std::vector<DrawStats> stats(rects.size());
+    std::atomic<size_t> next = 0;
+    auto render = [&]()
+        {
+            for (auto i = next++; i < rects.size(); i = next++)
+            {
+                tiles[i] = SceneRasterizer::RenderTile(*m_drawableActor, rects[i], transform, style,
+                    &stats[i], ratio);
+            }
+        };
+
+    auto workers = std::min(m_drawPool.maxThreadCount(), int(rects.size())) - 1;
+    for (auto i = 0; i < workers; ++i)
+        m_drawPool.start(render);
+    render();
+    m_drawPool.waitForDone();
+
+    m_lastDrawStats = DrawStats();
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        painter->drawImage(rects[i].topLeft(), tiles[i]);
+        m_lastDrawStats += stats[i];
+    }
+}
+
+void DrawablesScene::updateView()
+{
+    m_sceneMapper->SetTransform(QTransform()
+        .translate(m_frameCentre.x(), m_frameCentre.y())
+        .scale(m_scale, m_scale)
+        .translate(GetPosition().x(), GetPosition().y()));
+
+    if (m_pagedScene != nullptr && m_frozen == 0)
+    {
+        auto frame = QRectF(QPointF(0., 0.), QSizeF(2. * m_frameCentre.x(), 2. * m_frameCentre.y()));
+        m_pagedScene->Update(m_sceneMapper->MapRectToScene(frame));
+    }
+}
+
+void DrawablesScene::addShape(NodeModelRepPtr const& shape)
+{
+    m_drawableActor->Add(shape);
+    m_undoStack->RecordInsert(std::span(&shape, 1));
+    if (m_pagedScene != nullptr)
+        m_pagedScene->Adopt(shape);
+}
+
+void DrawablesScene::keepGrabStart()
+{
+    m_grabStart.reset();
+    auto grabbed = m_movableActor->GrabbedModel();
+    auto drawable = grabbed != nullptr ? m_drawableActor->FindRep(grabbed) : nullptr;
+    if (drawable != nullptr)
+        m_grabStart = GrabStart{ m_drawableActor->SharedRep(drawable), grabbed->GetGeometry() };
 }
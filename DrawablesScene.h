@@ -1,18 +1,25 @@
 #pragma once
 
 #include <algorithm>
+#include <optional>
 #include <vector>
 
 #include <QMouseEvent>
 #include <QKeyEvent>
+#include <QThreadPool>
 #include <QWidget>
 #include <QTextEdit>
 
 #include "drawables.h"
 #include "DrawableActor.h"
 #include "DrawablesInit.h"
+#include "PagedScene.h"
+#include "PerfCounters.h"
 #include "SceneMapper.h"
+#include "ShapeArena.h"
 #include "TextActor.h"
+#include "TileCache.h"
+#include "UndoStack.h"
 
 class DrawablesScene : public Movable
 {
@@ -24,11 +31,25 @@ class DrawablesScene : public Movable
     using Shape = DrawableActor::Shape;
     using SceneMapperPtr = std::shared_ptr<SceneMapper>;
     using TextAgenPtr = std::shared_ptr<TextActor>;
+    using DrawStats = DrawableActor::DrawStats;
 
     enum class SceneAction {
         None, Pan, Zoom, Rotate
     };
 
+    // keeps the shapes as they are while other threads read them, e.g. PosterExport:
+    // the chunks of a paged scene within the rect are paged in and nothing is paged
+    // out, and the mouse and key handlers leave the scene alone until the scope closes
+    class FreezeScope
+    {
+        public:
+        FreezeScope(DrawablesScene& scene, QRectF const& rect);
+        ~FreezeScope();
+
+        private:
+        DrawablesScene& m_scene;
+    };
+
     DrawablesScene(QWidget* parent);
     NodeModelRepPtr CreateShape(Shape shape, QPointF const& startPos);
     void MouseMoveHandler(QMouseEvent* ev);
@@ -38,22 +59,115 @@ class DrawablesScene : public Movable
     void KeyPressedHandler(QKeyEvent* ev);
     void SetCurrentShape(Shape action);
     void Draw(QPainter* painter);
+    DrawStats LastDrawStats() const;
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    // what the performance HUD shows, times in milliseconds
+    struct PerfStats
+    {
+        double frameMs = 0.;
+        double p50Ms = 0.;
+        double p99Ms = 0.;
+        int drawn = 0;
+        size_t shapes = 0;
+        double pickMs = 0.;
+        double sortMs = 0.;
+        double refreshMs = 0.;
+        quint64 changesPerFrame = 0;
+    };
+    PerfStats GetPerfStats() const;
+#endif
+    void SetTileCacheEnabled(bool enabled);
+    void SetBatchedDrawing(bool enabled);
+    // rasterises the frame in tiles on all cores and composites them
+    void SetThreadedDrawing(bool enabled);
+    void SetView(QPointF const& centre, int zoomLevel);
+    // removes all shapes, the new ones are built from a fresh arena
+    void Clear();
+    // the shapes of the scene in the SceneFile format, a failed Load keeps the scene
+    bool Save(QString const& fileName, QString* error = nullptr) const;
+    bool Load(QString const& fileName, QString* error = nullptr);
+    // adds the shapes of an SVG or JSON diagram on top of the scene, see SceneImporter
+    bool Import(QString const& fileName, QString* error = nullptr);
+    // splits the shapes into a page directory, see PagedScene
+    bool SavePaged(QString const& directory, QString* error = nullptr) const;
+    // replaces the scene with the chunks of a page directory that are around the view
+    bool OpenPaged(QString const& directory, QString* error = nullptr);
+    // the open page directory, nullptr if the scene is not paged
+    PagedScene* GetPagedScene() const;
+    // the bounds of all shapes, those of paged out chunks included
+    QRectF SceneBounds() const;
+    std::shared_ptr<ShapeArena> GetArena() const;
+    std::shared_ptr<DrawableActor> GetDrawableActor() const;
+    std::shared_ptr<UndoStack> GetUndoStack() const;
+    std::shared_ptr<MovableActor> GetMovableActor() const;
     bool IsPointOn(const QPointF& pos) const override;
 
     signals: 
     void Updated();
+    void RegionUpdated(QRegion const& region);
+    void Scrolled(QPoint const& delta);
 
     private:
+    void updateRegion(QRectF const& oldBounds, QRectF const& newBounds);
+    // a grabbed model that is part of a larger selection moves the whole selection
+    bool dragsSelection() const;
+    void draw(QPainter* painter);
+    void drawTiles(QPainter* painter);
+    bool drawDragLayers(QPainter* painter, NodeModel* grabbed);
+    void drawThreaded(QPainter* painter);
+    void updateView();
+    void addShape(NodeModelRepPtr const& shape);
+    // the geometry of the grabbed model is kept to record what the grab did to it
+    void keepGrabStart();
+
     std::shared_ptr<MovableActor> m_movableActor = std::make_shared<MovableActor>();
     std::shared_ptr<DrawableActor> m_drawableActor = 
-        std::make_shared<DrawableActor>(m_movableActor, [=]() { emit Updated(); });
+        std::make_shared<DrawableActor>(m_movableActor, [=]() { m_tileCache.Clear(); m_dragLayers.reset(); emit Updated(); },
+            [=](QRectF const& oldBounds, QRectF const& newBounds) { updateRegion(oldBounds, newBounds); });
+    std::shared_ptr<UndoStack> m_undoStack = std::make_shared<UndoStack>(*m_drawableActor);
 
 
     QWidget* m_parent = nullptr;
     Shape m_currentShape = Shape::None;
     SceneAction m_sceneAction = SceneAction::None;
     double m_scale = 1.0;
+    int m_zoomLevel = 0;
     QPointF m_frameCentre;
     SceneMapperPtr m_sceneMapper = std::make_shared<SceneMapper>();
+    std::shared_ptr<ShapeArena> m_arena = std::make_shared<ShapeArena>();
     TextAgenPtr m_textActor;
+    // declared after the actors, the pages are written back while the shapes are still there
+    std::unique_ptr<PagedScene> m_pagedScene;
+    DrawStats m_lastDrawStats;
+    TileCache m_tileCache;
+    bool m_tileCacheEnabled = false;
+    bool m_threadedDrawing = false;
+    QThreadPool m_drawPool;
+    // open FreezeScopes
+    int m_frozen = 0;
+
+    // while a shape is dragged the rest of the scene is composited from
+    // snapshots of what is below and above the grabbed model
+    struct DragLayers
+    {
+        NodeModel* model = nullptr;
+        NodeModelRep* active = nullptr;
+        QImage below;
+        QImage above;
+        quint64 viewVersion = 0;
+        PaintStyle style;
+    };
+    std::optional<DragLayers> m_dragLayers;
+
+    struct GrabStart
+    {
+        NodeModelRepPtr shape;
+        std::vector<QVector2D> geometry;
+    };
+    std::optional<GrabStart> m_grabStart;
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    FrameTimes m_frameTimes;
+    quint64 m_changesAtFrame = 0;
+    quint64 m_changesPerFrame = 0;
+#endif
 };
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "HandleRenderer.h"
+
+void HandleRenderer::DrawHandle(QPainter* painter, QPointF const& pos)
+{
+    painter->drawEllipse(pos, Radius, Radius);
+}
+
+void HandleRenderer::DrawHandles(QPainter* painter, NodeModel const& model)
+{
+    auto const& store = NodeStore::Shared();
+    for (auto index : model.m_nodeIndices)
+        DrawHandle(painter, store.Position(index).toPointF());
+}
+
+void HandleRenderer::DrawRectHandles(QPainter* painter, IntRect const& rect, bool outline)
+{
+    painter->save();
+    painter->setBrush(Qt::BrushStyle::NoBrush);
+    if (outline)
+    {
+        painter->drawPolygon(QPolygonF({ rect.m_nodeA->GetPosition().toPointF(),
+            rect.m_nodeB->GetPosition().toPointF(),
+            rect.m_nodeC->GetPosition().toPointF(),
+            rect.m_nodeD->GetPosition().toPointF() }));
+    }
+    DrawHandles(painter, rect);
+    painter->restore();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QPainter>
+
+#include "drawables.h"
+
+// Draws the handles of a selected shape straight from its node positions in the
+// NodeStore, so shapes do not need handle objects of their own.
+class HandleRenderer
+{
+    public:
+    static constexpr double Radius = 10.;
+
+    static void DrawHandle(QPainter* painter, QPointF const& pos);
+    // a handle on every node of the model
+    static void DrawHandles(QPainter* painter, NodeModel const& model);
+    // the outline and the handles of a rect, without filling it
+    static void DrawRectHandles(QPainter* painter, IntRect const& rect, bool outline);
+};
@@ -0,0 +1,147 @@
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "DrawableActor.h"
+#include "DrawablesInit.h"
+#include "MovableActor.h"
+#include "SyntheticScene.h"
+
+// QBENCHMARK suites of the model kernels: the IntRect corner and rotate handlers,
+// the IsPointOn hit tests and the z-order refresh through DrawableActor. One
+// kernel call per benchmark iteration, so the reported times are per call.
+class KernelBenchmarks : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+    void rectHandle_data();
+    void rectHandle();
+    void rectPointOn();
+    void vectorPointOn();
+    void zOrderRefresh_data();
+    void zOrderRefresh();
+};
+
+namespace
+{
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+    using Handle = std::shared_ptr<Node> IntRect::*;
+
+    Handle const Handles[] = {
+        &IntRect::m_nodeA, &IntRect::m_nodeB, &IntRect::m_nodeC, &IntRect::m_nodeD, &IntRect::m_nodeR
+    };
+
+    // a 100x60 rect turned by its rotate handle, so the handlers do not take the axis aligned case
+    std::shared_ptr<IntRect> rotatedRect()
+    {
+        auto rect = DrawablesInit::InitRect(QRectF(0., 0., 100., 60.))->m_rect;
+        rect->m_nodeR->GrabOn(rect->m_nodeR->GetPosition().toPointF());
+        rect->m_nodeR->SetExpectedPosition(QPointF(-20., -60.));
+        return rect;
+    }
+
+    // random points over the shape bounds and a margin around them
+    std::vector<QPointF> pointsAround(NodeModel const& model)
+    {
+        QRandomGenerator random(3);
+        auto bounds = model.Bounds().adjusted(-20., -20., 20., 20.);
+        std::vector<QPointF> points(1024);
+        for (auto& point : points)
+            point = bounds.topLeft() + QPointF(random.bounded(bounds.width()), random.bounded(bounds.height()));
+        return points;
+    }
+
+    int hitsOn(NodeModel const& model)
+    {
+        auto points = pointsAround(model);
+        size_t next = 0;
+        auto hits = 0;
+        QBENCHMARK
+        {
+            hits += model.IsPointOn(points[next++ & 1023]) ? 1 : 0;
+        }
+        return hits;
+    }
+}
+
+void KernelBenchmarks::rectHandle_data()
+{
+    QTest::addColumn<int>("handle");
+    QTest::newRow("corner_a") << 0;
+    QTest::newRow("corner_b") << 1;
+    QTest::newRow("corner_c") << 2;
+    QTest::newRow("corner_d") << 3;
+    QTest::newRow("rotate") << 4;
+}
+
+// drags one handle of a rotated rect around a circle
+void KernelBenchmarks::rectHandle()
+{
+    QFETCH(int, handle);
+    auto rect = rotatedRect();
+    auto rotate = Handles[handle] == &IntRect::m_nodeR;
+
+    auto node = ((*rect).*Handles[handle]).get();
+    auto centre = rect->GetPosition().toPointF();
+    auto start = node->GetPosition().toPointF();
+    auto radius = rotate ? QLineF(centre, start).length() : 20.;
+    auto around = rotate ? centre : start;
+    node->GrabOn(start);
+
+    auto step = 0;
+    QBENCHMARK
+    {
+        auto angle = step++ * .05;
+        node->SetExpectedPosition(around + radius * QPointF(std::cos(angle), std::sin(angle)));
+    }
+    QVERIFY(rect->Bounds().isValid());
+}
+
+void KernelBenchmarks::rectPointOn()
+{
+    auto rect = rotatedRect();
+    QVERIFY(hitsOn(*rect) > 0);
+}
+
+void KernelBenchmarks::vectorPointOn()
+{
+    auto line = DrawablesInit::InitLine(QPointF(0., 0.), QPointF(100., 60.))->GetModel();
+    QVERIFY(hitsOn(*line) > 0);
+}
+
+void KernelBenchmarks::zOrderRefresh_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+// brings single shapes of a scene to the front and back again
+void KernelBenchmarks::zOrderRefresh()
+{
+    QFETCH(int, count);
+    auto movableActor = std::make_shared<MovableActor>();
+    DrawableActor drawableActor(movableActor, []() {}, [](QRectF const&, QRectF const&) {});
+
+    auto shapes = SyntheticScene::Generate(count);
+    for (auto const& shape : shapes)
+        drawableActor.Add(shape);
+
+    size_t step = 0;
+    QBENCHMARK
+    {
+        auto model = shapes[(step++ * 7919) % shapes.size()]->GetModel();
+        model->SetSelected(true);
+        drawableActor.BringSelectedToFront();
+        drawableActor.SendSelectedToBack();
+        model->SetSelected(false);
+    }
+    QCOMPARE(drawableActor.GetDrawables().size(), shapes.size());
+}
+
+QTEST_MAIN(KernelBenchmarks)
+#include "KernelBenchmarks.moc"
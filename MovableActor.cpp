@@ -6,60 +6,120 @@ MovableActor::MovableActor()
 
 void MovableActor::Add(std::shared_ptr<NodeModel> nodeModel)
 {
-    m_movables.push_back(nodeModel);
-    for (auto node : nodeModel->m_nodes)
-        m_movables.push_back(node);
+    m_models[nodeModel.get()] = nodeModel;
+    for (auto const& node : nodeModel->m_nodes)
+    {
+        if (node->IsGrabbed()) // new shapes come with a grabbed node to drag them open
+        {
+            m_grabbed = node.get();
+            m_grabbedMovables.push_back(node.get());
+        }
+    }
+
+    updateBounds(nodeModel.get());
+    nodeModel->AddChangeListener(this, [this, model = nodeModel.get()]() { updateBounds(model); });
 }
 
 void MovableActor::SetExpectedToGrabbed(const QPointF& expectedPos)
 {
-    for (auto movable : m_movables)
-    {
-        if (!movable->IsGrabbed())
-            continue;
-
-        movable->SetExpectedPosition(expectedPos);
-        break;
-    }
+    if (m_grabbed != nullptr && m_grabbed->IsGrabbed())
+        m_grabbed->SetExpectedPosition(expectedPos);
 }
 
 void MovableActor::ReleaseAll()
 {
-    for (auto movable : m_movables)
+    for (auto movable : m_grabbedMovables)
         movable->Released();
+
+    m_grabbedMovables.clear();
+    m_grabbed = nullptr;
+}
+
+Movable* MovableActor::Grabbed() const
+{
+    return m_grabbed;
+}
+
+NodeModel* MovableActor::GrabbedModel() const
+{
+    if (m_grabbed == nullptr)
+        return nullptr;
+
+    if (auto model = dynamic_cast<NodeModel*>(m_grabbed))
+        return model;
+
+    return dynamic_cast<NodeModel*>(m_grabbed->Parent().lock().get());
 }
 
 void MovableActor::GrabOn(QPointF const& pos)
 {
-    for (auto movable : m_movables)
-    {
-        if (!movable->IsPointOn(pos))
-            continue;
+    PERF_SCOPE_TIMER(m_pickNs);
+
+    // the highest z-order wins, nodes are .1 above their model
+    Movable* grabbed = nullptr;
+    m_index.Query(pos, [&pos, &grabbed](Movable* movable, QRectF const&)
+        {
+            if (grabbed != nullptr && grabbed->GetZOrder() >= movable->GetZOrder())
+                return;
+
+            if (movable->IsPointOn(pos))
+                grabbed = movable;
+        });
 
-        movable->GrabOn(pos);
-        break;
+    if (grabbed != nullptr)
+    {
+        grabbed->GrabOn(pos);
+        m_grabbedMovables.push_back(grabbed);
     }
+
+    m_grabbed = grabbed;
+}
+
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+qint64 MovableActor::LastPickNs() const
+{
+    return m_pickNs;
+}
+#endif
+
+void MovableActor::Reorder(std::shared_ptr<NodeModel> nodeModel, double zOrder)
+{
+    nodeModel->SetZOrder(zOrder);
 }
 
-void MovableActor::Refresh()
+void MovableActor::RemoveNodeModel(std::shared_ptr<NodeModel> nodeModel)
 {
-    std::sort(m_movables.begin(), m_movables.end());
-    m_movables.erase(std::unique(m_movables.begin(), m_movables.end()), m_movables.end());
+    nodeModel->RemoveChangeListener(this);
+    m_index.Remove(nodeModel.get());
+    for (auto const& node : nodeModel->m_nodes)
+        m_index.Remove(node.get());
 
-    std::sort(m_movables.begin(), m_movables.end(), [](const MovablePtr& a, const MovablePtr& b)
+    if (GrabbedModel() == nodeModel.get())
+        m_grabbed = nullptr;
+
+    // the removed shape and its nodes are not released later
+    auto model = nodeModel.get();
+    std::erase_if(m_grabbedMovables, [model](Movable* movable)
         {
-            return a->GetZOrder() > b->GetZOrder(); //grab in descending order
+            return movable == model || dynamic_cast<NodeModel*>(movable->Parent().lock().get()) == model;
         });
+    m_models.erase(model);
 }
 
-void MovableActor::RemoveNodeModel(std::shared_ptr<NodeModel> nodeModel)
+void MovableActor::Clear()
+{
+    for (auto const& [model, shared] : m_models)
+        model->RemoveChangeListener(this);
+
+    m_models.clear();
+    m_index.Clear();
+    m_grabbedMovables.clear();
+    m_grabbed = nullptr;
+}
+
+void MovableActor::updateBounds(NodeModel* nodeModel)
 {
-    auto nodes = nodeModel->m_nodes.values();
-    m_movables.erase(
-        std::remove_if(m_movables.begin(), m_movables.end(),
-        [&nodes, &nodeModel](MovablePtr& const movable) {
-            return (movable == nodeModel) || std::find_if(nodes.begin(), nodes.end(),
-                [&movable](std::shared_ptr<Node>& const node) {
-                    return movable == node;
-                }) != nodes.end(); }), m_movables.end());
+    m_index.Update(nodeModel, nodeModel->Bounds());
+    for (auto const& node : nodeModel->m_nodes)
+        m_index.Update(node.get(), node->Bounds());
 }
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
 #include "drawables.h"
+#include "PerfCounters.h"
+#include "SpatialIndex.h"
 
 class MovableActor
 {
@@ -11,9 +18,26 @@ class MovableActor
     void SetExpectedToGrabbed(const QPointF& expectedPos);
     void ReleaseAll();
     void GrabOn(QPointF const& pos);
-    void Refresh();
+    Movable* Grabbed() const;
+    NodeModel* GrabbedModel() const;
+    void Reorder(std::shared_ptr<NodeModel> nodeModel, double zOrder);
     void RemoveNodeModel(std::shared_ptr<NodeModel> nodeModel);
+    void Clear();
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    // how long the last GrabOn took to find what is under the mouse
+    qint64 LastPickNs() const;
+#endif
 
     private:
-    std::vector<MovablePtr> m_movables;
-};
\ No newline at end of file
+    void updateBounds(NodeModel* nodeModel);
+
+    // picking goes through the index, the models are kept here
+    std::unordered_map<NodeModel*, std::shared_ptr<NodeModel>> m_models;
+    Movable* m_grabbed = nullptr;
+    // everything grabbed since the last release, new shapes come with a grabbed node
+    std::vector<Movable*> m_grabbedMovables;
+    SpatialIndex<Movable*> m_index;
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    qint64 m_pickNs = 0;
+#endif
+};
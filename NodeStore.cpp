@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <limits>
+
+#include "NodeStore.h"
+
+NodeStore& NodeStore::Shared()
+{
+    static NodeStore store;
+    return store;
+}
+
+NodeStore::Index NodeStore::Allocate(QVector2D const& pos)
+{
+    Q_ASSERT(onOwnerThread());
+
+    Index index;
+    if (!m_free.empty())
+    {
+        index = m_free.back();
+        m_free.pop_back();
+    }
+    else
+    {
+        index = static_cast<Index>(m_x.size());
+        m_x.push_back(0.f);
+        m_y.push_back(0.f);
+        m_z.push_back(0.);
+        m_flags.push_back(0);
+    }
+
+    SetPosition(index, pos);
+    m_z[index] = 0.;
+    m_flags[index] = Selected;
+    return index;
+}
+
+void NodeStore::Release(Index index)
+{
+    Q_ASSERT(onOwnerThread());
+    m_free.push_back(index);
+}
+
+size_t NodeStore::Size() const
+{
+    return m_x.size() - m_free.size();
+}
+
+QRectF NodeStore::Bounds(std::span<Index const> indices, float margin) const
+{
+    if (indices.empty())
+        return QRectF();
+
+    auto left = std::numeric_limits<float>::max();
+    auto top = std::numeric_limits<float>::max();
+    auto right = std::numeric_limits<float>::lowest();
+    auto bottom = std::numeric_limits<float>::lowest();
+    for (auto index : indices)
+    {
+        left = std::min(left, m_x[index]);
+        right = std::max(right, m_x[index]);
+        top = std::min(top, m_y[index]);
+        bottom = std::max(bottom, m_y[index]);
+    }
+
+    return QRectF(QPointF(left - margin, top - margin), QPointF(right + margin, bottom + margin));
+}
+
+void NodeStore::Translate(std::span<Index const> indices, QVector2D const& delta)
+{
+    Q_ASSERT(onOwnerThread());
+    auto dx = delta.x();
+    auto dy = delta.y();
+    for (auto index : indices)
+    {
+        m_x[index] += dx;
+        m_y[index] += dy;
+    }
+}
+
+void NodeStore::SetZOrder(std::span<Index const> indices, double zOrder)
+{
+    Q_ASSERT(onOwnerThread());
+    for (auto index : indices)
+        m_z[index] = zOrder;
+}
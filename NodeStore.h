@@ -0,0 +1,83 @@
+#pragma once
+
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <QRectF>
+#include <QVector2D>
+
+// Scene wide storage of the node positions, z-orders and flags as separate
+// contiguous arrays. A node keeps its index for its whole life, freed indices
+// are reused by the next node, so the nodes of one shape usually sit side by side.
+// Nodes are created, released and moved on the thread that first used the store,
+// the gui thread; other threads may only read while it leaves the nodes alone.
+// An allocation can move the arrays, so there is no safe concurrent mutation and
+// debug builds assert the thread instead of locking.
+class NodeStore
+{
+    public:
+    using Index = quint32;
+
+    enum Flag : quint8 {
+        Selected = 1, Grabbed = 2
+    };
+
+    static NodeStore& Shared();
+
+    Index Allocate(QVector2D const& pos);
+    void Release(Index index);
+    size_t Size() const;
+
+    QVector2D Position(Index index) const
+    {
+        return QVector2D(m_x[index], m_y[index]);
+    }
+
+    void SetPosition(Index index, QVector2D const& pos)
+    {
+        Q_ASSERT(onOwnerThread());
+        m_x[index] = pos.x();
+        m_y[index] = pos.y();
+    }
+
+    double ZOrder(Index index) const
+    {
+        return m_z[index];
+    }
+
+    void SetZOrder(Index index, double zOrder)
+    {
+        Q_ASSERT(onOwnerThread());
+        m_z[index] = zOrder;
+    }
+
+    bool HasFlag(Index index, Flag flag) const
+    {
+        return (m_flags[index] & flag) != 0;
+    }
+
+    void SetFlag(Index index, Flag flag, bool on)
+    {
+        Q_ASSERT(onOwnerThread());
+        m_flags[index] = on ? (m_flags[index] | flag) : (m_flags[index] & ~flag);
+    }
+
+    // bulk operations over the nodes of a shape
+    QRectF Bounds(std::span<Index const> indices, float margin = 0.f) const;
+    void Translate(std::span<Index const> indices, QVector2D const& delta);
+    void SetZOrder(std::span<Index const> indices, double zOrder);
+
+    private:
+    bool onOwnerThread() const
+    {
+        return std::this_thread::get_id() == m_owner;
+    }
+
+    std::thread::id const m_owner = std::this_thread::get_id();
+    std::vector<float> m_x;
+    std::vector<float> m_y;
+    std::vector<double> m_z;
+    std::vector<quint8> m_flags;
+    std::vector<Index> m_free;
+};
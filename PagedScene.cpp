@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+
+#include "PagedScene.h"
+#include "SceneFile.h"
+
+namespace
+{
+    constexpr quint32 IndexMagic = 0x50444e49; // "INDP"
+    constexpr quint32 IndexVersion = 1;
+
+    bool fail(QString* error, QString const& message)
+    {
+        if (error != nullptr)
+            *error = message;
+        return false;
+    }
+}
+
+bool PagedScene::Build(QString const& directory, std::span<NodeModelRepPtr const> shapes,
+    double chunkSize, QString* error)
+{
+    if (!QDir().mkpath(directory))
+        return fail(error, QStringLiteral("%1 cannot be created").arg(directory));
+
+    // the groups keep the drawing order of the shapes
+    std::map<Key, std::vector<NodeModelRepPtr>> groups;
+    for (auto const& shape : shapes)
+        groups[keyOf(shape->GetModel()->ShapeBounds().center(), chunkSize)].push_back(shape);
+
+    std::map<Key, Chunk> chunks;
+    for (auto const& [key, group] : groups)
+    {
+        if (!SceneFile::Save(fileOf(directory, key), group, error))
+            return false;
+
+        auto& chunk = chunks[key];
+        chunk.key = key;
+        chunk.count = quint32(group.size());
+        chunk.minZ = std::numeric_limits<double>::infinity();
+        chunk.maxZ = -std::numeric_limits<double>::infinity();
+        for (auto const& shape : group)
+        {
+            auto model = shape->GetModel();
+            chunk.bounds |= shape->Bounds();
+            chunk.minZ = std::min(chunk.minZ, model->GetZOrder());
+            chunk.maxZ = std::max(chunk.maxZ, model->GetZOrder());
+        }
+    }
+
+    return writeIndex(directory, chunkSize, chunks, error);
+}
+
+PagedScene::PagedScene(DrawableActorPtr drawableActor) : m_drawableActor(std::move(drawableActor))
+{
+}
+
+PagedScene::~PagedScene()
+{
+    QString error;
+    if (!WriteBack(&error))
+        qWarning() << "paged scene not written back:" << error;
+
+    for (auto& [key, chunk] : m_chunks)
+    {
+        for (auto const& shape : chunk.shapes)
+            shape->GetModel()->RemoveChangeListener(this);
+    }
+}
+
+bool PagedScene::Open(QString const& directory, QString* error)
+{
+    QFile file(QDir(directory).filePath(IndexName));
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(error, file.errorString());
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    quint32 count = 0;
+    double chunkSize = 0.;
+    in >> magic >> version >> chunkSize >> count;
+    if (magic != IndexMagic || version > IndexVersion || !(chunkSize > 0.))
+        return fail(error, QStringLiteral("%1 is not a page index").arg(file.fileName()));
+
+    std::map<Key, Chunk> chunks;
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i)
+    {
+        qint32 x = 0;
+        qint32 y = 0;
+        Chunk chunk;
+        in >> x >> y >> chunk.bounds >> chunk.minZ >> chunk.maxZ >> chunk.count;
+        chunk.key = Key(x, y);
+        chunks.emplace(chunk.key, std::move(chunk));
+    }
+    if (in.status() != QDataStream::Ok)
+        return fail(error, QStringLiteral("%1 is damaged").arg(file.fileName()));
+
+    m_directory = directory;
+    m_chunkSize = chunkSize;
+    m_chunks = std::move(chunks);
+    m_index.Clear();
+    m_minZ = std::numeric_limits<double>::infinity();
+    m_maxZ = -std::numeric_limits<double>::infinity();
+    for (auto& [key, chunk] : m_chunks)
+    {
+        if (!chunk.bounds.isNull())
+            m_index.Insert(&chunk, chunk.bounds);
+        reserve(chunk);
+    }
+    return true;
+}
+
+void PagedScene::Update(QRectF const& visibleRect)
+{
+    DrawableActor::UpdateScope scope(*m_drawableActor);
+    PageIn(visibleRect.adjusted(-m_margin, -m_margin, m_margin, m_margin));
+
+    auto bytes = GetStats().bytes;
+    if (bytes <= m_budget)
+        return;
+
+    std::vector<Chunk*> candidates;
+    for (auto& [key, chunk] : m_chunks)
+    {
+        if (chunk.arena != nullptr && chunk.lastUsed != m_tick)
+            candidates.push_back(&chunk);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](Chunk const* a, Chunk const* b) { return a->lastUsed < b->lastUsed; });
+
+    auto evictions = m_stats.evictions;
+    for (auto chunk : candidates)
+    {
+        if (bytes <= m_budget)
+            break;
+
+        auto chunkBytes = chunk->arena->LiveBytes();
+        evict(*chunk);
+        if (chunk->arena == nullptr)
+            bytes -= std::min(bytes, chunkBytes);
+    }
+
+    if (m_stats.evictions != evictions && m_evicted)
+        m_evicted();
+}
+
+void PagedScene::PageIn(QRectF const& rect)
+{
+    ++m_tick;
+    DrawableActor::UpdateScope scope(*m_drawableActor);
+    std::vector<Chunk*> chunks;
+    m_index.Query(rect, [&chunks](Chunk* chunk, QRectF const&) { chunks.push_back(chunk); });
+    for (auto chunk : chunks)
+    {
+        chunk->lastUsed = m_tick;
+        if (chunk->arena == nullptr)
+            load(*chunk);
+    }
+}
+
+QRectF PagedScene::Bounds() const
+{
+    QRectF bounds;
+    for (auto const& [key, chunk] : m_chunks)
+        bounds |= chunk.bounds;
+    return bounds;
+}
+
+void PagedScene::Adopt(NodeModelRepPtr const& shape)
+{
+    // a deleted shape that comes back before its chunk was written
+    auto owner = m_owners.find(shape.get());
+    if (owner != m_owners.end())
+    {
+        owner->second->dirty = true;
+        return;
+    }
+
+    auto key = keyOf(shape->GetModel()->ShapeBounds().center(), m_chunkSize);
+    auto& chunk = m_chunks[key];
+    chunk.key = key;
+
+    // the shapes already in the chunk are saved together with the new one,
+    // a chunk that cannot be read is not overwritten
+    if (chunk.arena == nullptr && chunk.count > 0 && !load(chunk))
+        return;
+    if (chunk.arena == nullptr)
+        chunk.arena = std::make_shared<ShapeArena>();
+
+    track(chunk, shape);
+    reserve(shape->GetModel()->GetZOrder(), shape->GetModel()->GetZOrder());
+    chunk.dirty = true;
+    chunk.lastUsed = m_tick;
+    chunk.bounds |= shape->Bounds();
+    m_index.Update(&chunk, chunk.bounds);
+}
+
+bool PagedScene::WriteBack(QString* error)
+{
+    auto written = false;
+    for (auto& [key, chunk] : m_chunks)
+    {
+        if (chunk.arena == nullptr || !isDirty(chunk))
+            continue;
+
+        if (!write(chunk, error))
+            return false;
+        written = true;
+    }
+
+    return !written || writeIndex(m_directory, m_chunkSize, m_chunks, error);
+}
+
+void PagedScene::SetBudget(size_t bytes)
+{
+    m_budget = bytes;
+}
+
+void PagedScene::SetPrefetchMargin(double margin)
+{
+    m_margin = margin;
+}
+
+void PagedScene::SetEvictionHandler(EvictionHandler handler)
+{
+    m_evicted = std::move(handler);
+}
+
+PagedScene::Stats PagedScene::GetStats() const
+{
+    auto stats = m_stats;
+    stats.chunks = static_cast<int>(m_chunks.size());
+    for (auto const& [key, chunk] : m_chunks)
+    {
+        if (chunk.arena == nullptr)
+            continue;
+
+        ++stats.loaded;
+        stats.dirty += chunk.dirty ? 1 : 0;
+        stats.bytes += chunk.arena->LiveBytes();
+    }
+    return stats;
+}
+
+PagedScene::Key PagedScene::keyOf(QPointF const& pos, double chunkSize)
+{
+    return Key(static_cast<int>(std::floor(pos.x() / chunkSize)),
+        static_cast<int>(std::floor(pos.y() / chunkSize)));
+}
+
+QString PagedScene::fileOf(QString const& directory, Key const& key)
+{
+    return QDir(directory).filePath(QStringLiteral("chunk_%1_%2.idscene").arg(key.first).arg(key.second));
+}
+
+bool PagedScene::writeIndex(QString const& directory, double chunkSize,
+    std::map<Key, Chunk> const& chunks, QString* error)
+{
+    QSaveFile file(QDir(directory).filePath(IndexName));
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, file.errorString());
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_0);
+    out << IndexMagic << IndexVersion << chunkSize << quint32(chunks.size());
+    for (auto const& [key, chunk] : chunks)
+    {
+        out << qint32(key.first) << qint32(key.second) << chunk.bounds
+            << chunk.minZ << chunk.maxZ << chunk.count;
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit())
+        return fail(error, file.errorString());
+
+    return true;
+}
+
+bool PagedScene::load(Chunk& chunk)
+{
+    auto arena = std::make_shared<ShapeArena>();
+    std::optional<std::vector<NodeModelRepPtr>> shapes;
+    QString error;
+    {
+        ShapeArena::Scope scope(arena);
+        shapes = SceneFile::Load(fileOf(m_directory, chunk.key), &error);
+    }
+    if (!shapes)
+    {
+        qWarning() << "chunk not paged in:" << error;
+        return false;
+    }
+
+    chunk.arena = std::move(arena);
+    chunk.shapes.clear();
+    chunk.zOrders.clear();
+    for (auto const& shape : *shapes)
+    {
+        chunk.zOrders.push_back(shape->GetModel()->GetZOrder());
+        m_drawableActor->Insert(shape);
+        track(chunk, shape);
+    }
+    ++m_stats.loads;
+    return true;
+}
+
+void PagedScene::evict(Chunk& chunk)
+{
+    if (isDirty(chunk))
+    {
+        QString error;
+        if (!write(chunk, &error) || !writeIndex(m_directory, m_chunkSize, m_chunks, &error))
+        {
+            // the edits stay in memory rather than getting lost
+            qWarning() << "chunk not paged out:" << error;
+            return;
+        }
+    }
+
+    for (auto const& shape : chunk.shapes)
+    {
+        shape->GetModel()->RemoveChangeListener(this);
+        m_owners.erase(shape.get());
+    }
+
+    m_drawableActor->Remove(chunk.shapes);
+    chunk.shapes.clear();
+    chunk.zOrders.clear();
+    chunk.arena.reset();
+    ++m_stats.evictions;
+}
+
+bool PagedScene::isDirty(Chunk const& chunk) const
+{
+    if (chunk.dirty || chunk.shapes.size() != chunk.zOrders.size())
+        return true;
+
+    // deleted and re-ordered shapes do not notify their listeners
+    for (size_t i = 0; i < chunk.shapes.size(); ++i)
+    {
+        auto const& shape = chunk.shapes[i];
+        if (m_drawableActor->SharedRep(shape.get()) == nullptr ||
+            shape->GetModel()->GetZOrder() != chunk.zOrders[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool PagedScene::write(Chunk& chunk, QString* error)
+{
+    // the deleted shapes are left out, the rest is saved back to front
+    std::vector<NodeModelRepPtr> shapes;
+    for (auto const& shape : chunk.shapes)
+    {
+        if (m_drawableActor->SharedRep(shape.get()) != nullptr)
+            shapes.push_back(shape);
+        else
+        {
+            shape->GetModel()->RemoveChangeListener(this);
+            m_owners.erase(shape.get());
+        }
+    }
+    std::sort(shapes.begin(), shapes.end(), [](NodeModelRepPtr const& a, NodeModelRepPtr const& b)
+        {
+            return a->GetModel()->GetZOrder() < b->GetModel()->GetZOrder();
+        });
+
+    if (!SceneFile::Save(fileOf(m_directory, chunk.key), shapes, error))
+        return false;
+
+    chunk.shapes = std::move(shapes);
+    chunk.zOrders.clear();
+    chunk.bounds = QRectF();
+    for (auto const& shape : chunk.shapes)
+    {
+        chunk.zOrders.push_back(shape->GetModel()->GetZOrder());
+        chunk.bounds |= shape->Bounds();
+    }
+    chunk.count = quint32(chunk.shapes.size());
+    chunk.minZ = chunk.zOrders.empty() ? 0. : chunk.zOrders.front();
+    chunk.maxZ = chunk.zOrders.empty() ? 0. : chunk.zOrders.back();
+    chunk.dirty = false;
+    reserve(chunk);
+
+    if (chunk.bounds.isNull())
+        m_index.Remove(&chunk);
+    else
+        m_index.Update(&chunk, chunk.bounds);
+
+    ++m_stats.writes;
+    return true;
+}
+
+void PagedScene::reserve(Chunk const& chunk)
+{
+    // an empty chunk has no z-order range of its own
+    if (chunk.count > 0)
+        reserve(chunk.minZ, chunk.maxZ);
+}
+
+// shapes added while the rest is paged out go in front of or behind all of them,
+// so the range covers every z-order that was ever written or adopted
+void PagedScene::reserve(double minZ, double maxZ)
+{
+    m_minZ = std::min(m_minZ, minZ);
+    m_maxZ = std::max(m_maxZ, maxZ);
+    m_drawableActor->ReserveZOrders(m_minZ, m_maxZ);
+}
+
+void PagedScene::track(Chunk& chunk, NodeModelRepPtr const& shape)
+{
+    chunk.shapes.push_back(shape);
+    m_owners[shape.get()] = &chunk;
+
+    // a shape moved out of its chunk keeps the chunk visible where it is now
+    shape->GetModel()->AddChangeListener(this, [this, chunk = &chunk, drawable = shape.get()]()
+        {
+            chunk->dirty = true;
+            auto bounds = drawable->Bounds();
+            if (chunk->bounds.contains(bounds))
+                return;
+
+            chunk->bounds |= bounds;
+            m_index.Update(chunk, chunk->bounds);
+        });
+}
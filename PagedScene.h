@@ -0,0 +1,120 @@
+#pragma once
+
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <QRectF>
+#include <QString>
+
+#include "DrawableActor.h"
+#include "ShapeArena.h"
+#include "SpatialIndex.h"
+
+// Scene kept in a page directory. The shapes are split into square chunks by the
+// centre of their shape, every chunk is a SceneFile of its own and an index lists
+// the chunks with their bounds and z-order ranges. Only the chunks around the view
+// are instantiated, each in an arena of its own, so an evicted chunk gives its
+// memory back in one go. Edited chunks are written back before they are evicted.
+class PagedScene
+{
+    public:
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+    using DrawableActorPtr = std::shared_ptr<DrawableActor>;
+
+    static constexpr char const* IndexName = "pages.idx";
+    static constexpr double DefaultChunkSize = 2048.;
+
+    // called after chunks were paged out, their shapes are gone from the actor
+    using EvictionHandler = std::function<void()>;
+
+    struct Stats
+    {
+        int chunks = 0;
+        int loaded = 0;
+        int dirty = 0;
+        // arena bytes of the loaded chunks
+        size_t bytes = 0;
+        int loads = 0;
+        int evictions = 0;
+        int writes = 0;
+    };
+
+    // writes shapes in drawing order, with the distinct z-orders an actor gives them, as a page directory
+    static bool Build(QString const& directory, std::span<NodeModelRepPtr const> shapes,
+        double chunkSize = DefaultChunkSize, QString* error = nullptr);
+
+    PagedScene(DrawableActorPtr drawableActor);
+    // writes the dirty chunks back
+    ~PagedScene();
+    bool Open(QString const& directory, QString* error = nullptr);
+    // pages in the chunks within the prefetch margin around visibleRect and evicts the
+    // least recently visible others while the loaded chunks take more than the budget
+    void Update(QRectF const& visibleRect);
+    // pages in all chunks within rect, whatever the budget, and evicts nothing
+    void PageIn(QRectF const& rect);
+    // the bounds of all chunks, loaded or not
+    QRectF Bounds() const;
+    // places a shape created in the paged scene into the chunk under its centre,
+    // a shape that is still tracked by a chunk stays in that one
+    void Adopt(NodeModelRepPtr const& shape);
+    bool WriteBack(QString* error = nullptr);
+    void SetBudget(size_t bytes);
+    // scene units around the view that are paged in ahead of time
+    void SetPrefetchMargin(double margin);
+    void SetEvictionHandler(EvictionHandler handler);
+    Stats GetStats() const;
+
+    private:
+    using Key = std::pair<int, int>;
+
+    struct Chunk
+    {
+        Key key;
+        QRectF bounds;
+        double minZ = 0.;
+        double maxZ = 0.;
+        quint32 count = 0;
+        // set while the chunk is paged in
+        std::shared_ptr<ShapeArena> arena;
+        std::vector<NodeModelRepPtr> shapes;
+        // z-orders of the shapes as they were read or written last
+        std::vector<double> zOrders;
+        bool dirty = false;
+        quint64 lastUsed = 0;
+    };
+
+    static Key keyOf(QPointF const& pos, double chunkSize);
+    static QString fileOf(QString const& directory, Key const& key);
+    static bool writeIndex(QString const& directory, double chunkSize,
+        std::map<Key, Chunk> const& chunks, QString* error);
+
+    bool load(Chunk& chunk);
+    void evict(Chunk& chunk);
+    bool isDirty(Chunk const& chunk) const;
+    bool write(Chunk& chunk, QString* error);
+    void reserve(Chunk const& chunk);
+    void reserve(double minZ, double maxZ);
+    void track(Chunk& chunk, NodeModelRepPtr const& shape);
+
+    DrawableActorPtr m_drawableActor;
+    QString m_directory;
+    double m_chunkSize = DefaultChunkSize;
+    std::map<Key, Chunk> m_chunks;
+    // the chunk that saves a shape, for every shape of the loaded chunks
+    std::unordered_map<NodeModelRep const*, Chunk*> m_owners;
+    SpatialIndex<Chunk*> m_index;
+    size_t m_budget = size_t(256) << 20;
+    double m_margin = DefaultChunkSize / 2.;
+    // z-order range of the whole directory
+    double m_minZ = std::numeric_limits<double>::infinity();
+    double m_maxZ = -std::numeric_limits<double>::infinity();
+    EvictionHandler m_evicted;
+    quint64 m_tick = 0;
+    Stats m_stats;
+};
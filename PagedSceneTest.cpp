@@ -0,0 +1,123 @@
+#include <memory>
+#include <vector>
+
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "DrawableActor.h"
+#include "DrawablesInit.h"
+#include "MovableActor.h"
+#include "PagedScene.h"
+
+// Edits in a paged scene that have to survive the eviction of their chunk.
+class PagedSceneTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+    void initTestCase();
+    void textEditSurvivesEviction();
+    void cleanChunkIsNotWritten();
+
+    private:
+    using NodeModelRepPtr = PagedScene::NodeModelRepPtr;
+
+    // a text near the origin and a rect in a chunk far away from it
+    bool build(QString const& directory);
+    static TextRep* findText(DrawableActor const& drawableActor);
+
+    QTemporaryDir m_dir;
+};
+
+namespace
+{
+    QRectF const Near(-10., -10., 100., 100.);
+    QRectF const Far(9990., 9990., 100., 100.);
+
+    std::shared_ptr<DrawableActor> makeActor()
+    {
+        return std::make_shared<DrawableActor>(std::make_shared<MovableActor>(),
+            []() {}, [](QRectF const&, QRectF const&) {});
+    }
+}
+
+void PagedSceneTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+bool PagedSceneTest::build(QString const& directory)
+{
+    std::vector<NodeModelRepPtr> shapes{
+        DrawablesInit::InitText(QPointF(0., 0.), QStringLiteral("before")),
+        DrawablesInit::InitRect(QRectF(10000., 10000., 40., 20.)),
+    };
+    for (size_t i = 0; i < shapes.size(); ++i)
+        shapes[i]->GetModel()->SetZOrder(double(i));
+
+    QString error;
+    if (PagedScene::Build(directory, shapes, PagedScene::DefaultChunkSize, &error))
+        return true;
+
+    qWarning() << error;
+    return false;
+}
+
+TextRep* PagedSceneTest::findText(DrawableActor const& drawableActor)
+{
+    for (auto const& drawable : drawableActor.GetDrawables())
+    {
+        if (auto text = dynamic_cast<TextRep*>(drawable.get()))
+            return text;
+    }
+    return nullptr;
+}
+
+// the chunk of the edited text is written when the far view evicts it
+void PagedSceneTest::textEditSurvivesEviction()
+{
+    auto directory = m_dir.filePath("edited");
+    QVERIFY(build(directory));
+
+    auto drawableActor = makeActor();
+    PagedScene scene(drawableActor);
+    QString error;
+    QVERIFY2(scene.Open(directory, &error), qPrintable(error));
+    scene.SetBudget(0);
+    scene.SetPrefetchMargin(0.);
+
+    scene.Update(Near);
+    auto text = findText(*drawableActor);
+    QVERIFY(text != nullptr);
+    text->SetText(QStringLiteral("after"));
+
+    scene.Update(Far);
+    QVERIFY(findText(*drawableActor) == nullptr);
+    QCOMPARE(scene.GetStats().writes, 1);
+
+    scene.Update(Near);
+    text = findText(*drawableActor);
+    QVERIFY(text != nullptr);
+    QCOMPARE(text->GetText(), QStringLiteral("after"));
+}
+
+void PagedSceneTest::cleanChunkIsNotWritten()
+{
+    auto directory = m_dir.filePath("clean");
+    QVERIFY(build(directory));
+
+    auto drawableActor = makeActor();
+    PagedScene scene(drawableActor);
+    QVERIFY(scene.Open(directory));
+    scene.SetBudget(0);
+    scene.SetPrefetchMargin(0.);
+
+    scene.Update(Near);
+    scene.Update(Far);
+    scene.Update(Near);
+    QCOMPARE(scene.GetStats().writes, 0);
+    QVERIFY(scene.GetStats().evictions >= 2);
+}
+
+QTEST_MAIN(PagedSceneTest)
+#include "PagedSceneTest.moc"
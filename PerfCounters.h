@@ -0,0 +1,80 @@
+#pragma once
+
+// Counters behind the performance HUD. They are compiled in with the
+// INTERACTIVE_DRAWING_PERF_COUNTERS definition, set by the CMake option of the
+// same name; without it the macros expand to nothing and the counters are gone.
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <QElapsedTimer>
+
+// stores the nanoseconds the enclosing scope took in target
+template<typename Target>
+class PerfTimer
+{
+    public:
+    explicit PerfTimer(Target& target) : m_target(target)
+    {
+        m_timer.start();
+    }
+
+    ~PerfTimer()
+    {
+        m_target = m_timer.nsecsElapsed();
+    }
+
+    private:
+    Target& m_target;
+    QElapsedTimer m_timer;
+};
+
+// the times of the last frames, for the percentiles
+class FrameTimes
+{
+    public:
+    static constexpr size_t Capacity = 240;
+
+    void Add(qint64 nanoseconds)
+    {
+        m_times[m_next] = nanoseconds;
+        m_next = (m_next + 1) % Capacity;
+        m_count = std::min(m_count + 1, Capacity);
+    }
+
+    qint64 Last() const
+    {
+        return m_count == 0 ? 0 : m_times[(m_next + Capacity - 1) % Capacity];
+    }
+
+    // fraction between 0 and 1, 0.99 is the 99th percentile
+    qint64 Percentile(double fraction) const
+    {
+        if (m_count == 0)
+            return 0;
+
+        std::vector<qint64> times(m_times.begin(), m_times.begin() + m_count);
+        auto nth = times.begin() + std::min(size_t(fraction * m_count), m_count - 1);
+        std::nth_element(times.begin(), nth, times.end());
+        return *nth;
+    }
+
+    private:
+    std::array<qint64, Capacity> m_times{};
+    size_t m_next = 0;
+    size_t m_count = 0;
+};
+
+#define PERF_CONCAT_(a, b) a##b
+#define PERF_CONCAT(a, b) PERF_CONCAT_(a, b)
+#define PERF_SCOPE_TIMER(target) PerfTimer PERF_CONCAT(perfTimer, __LINE__)(target)
+#define PERF_COUNT(counter) (++(counter))
+
+#else
+
+#define PERF_SCOPE_TIMER(target)
+#define PERF_COUNT(counter)
+
+#endif
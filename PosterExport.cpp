@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+#include <QImage>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QTransform>
+
+#include "PosterExport.h"
+
+namespace
+{
+    // bytes per pixel of the file
+    constexpr qint64 Depth = 3;
+
+    struct Tile
+    {
+        QRect rect;
+        QImage image;
+    };
+
+    bool fail(QString* error, QString const& message)
+    {
+        if (error != nullptr)
+            *error = message;
+        return false;
+    }
+
+    // the rows of the tile go to their places in the file
+    bool writeTile(QSaveFile& file, qint64 headerSize, qint64 rowBytes, Tile const& tile)
+    {
+        auto bytes = qint64(tile.rect.width()) * Depth;
+        for (auto y = 0; y < tile.rect.height(); ++y)
+        {
+            auto offset = headerSize + qint64(tile.rect.top() + y) * rowBytes + qint64(tile.rect.left()) * Depth;
+            if (!file.seek(offset) ||
+                file.write(reinterpret_cast<char const*>(tile.image.constScanLine(y)), bytes) != bytes)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+PosterExport::PosterExport(DrawableActor const& drawableActor) : m_drawableActor(drawableActor)
+{
+}
+
+void PosterExport::SetProgressHandler(ProgressHandler handler)
+{
+    m_progress = std::move(handler);
+}
+
+bool PosterExport::Export(QString const& fileName, Options const& options, QString* error)
+{
+    m_stats = Stats();
+    auto width = std::ceil(options.sceneRect.width() * options.scale);
+    auto height = std::ceil(options.sceneRect.height() * options.scale);
+    if (options.sceneRect.isEmpty() || options.scale <= 0.)
+        return fail(error, QStringLiteral("There is nothing to export"));
+    if (width > INT_MAX || height > INT_MAX)
+        return fail(error, QStringLiteral("The poster is too large"));
+
+    auto size = QSize(int(width), int(height));
+    auto tileSize = std::max(options.tileSize, 16);
+    auto columns = (size.width() + tileSize - 1) / tileSize;
+    auto total = qint64(columns) * ((size.height() + tileSize - 1) / tileSize);
+    m_stats.size = size;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, file.errorString());
+
+    auto header = QStringLiteral("P7\nWIDTH %1\nHEIGHT %2\nDEPTH %3\nMAXVAL 255\nTUPLTYPE RGB\nENDHDR\n")
+        .arg(size.width()).arg(size.height()).arg(Depth).toLatin1();
+    auto rowBytes = qint64(size.width()) * Depth;
+    m_stats.bytes = header.size() + rowBytes * size.height();
+    if (file.write(header) != header.size() || !file.resize(m_stats.bytes))
+        return fail(error, file.errorString());
+
+    // the scene rect at the top left corner, scaled to the output pixels
+    auto sceneToDevice = QTransform::fromScale(options.scale, options.scale)
+        .translate(-options.sceneRect.left(), -options.sceneRect.top());
+
+    QThreadPool pool;
+    if (options.threads > 0)
+        pool.setMaxThreadCount(options.threads);
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::deque<Tile> done;
+    auto render = [this, &options, &sceneToDevice, &mutex, &finished, &done](QRect const& rect)
+        {
+            QImage image(rect.size(), QImage::Format_RGB32);
+            image.fill(options.background);
+            SceneRasterizer::Render(m_drawableActor, image, rect, sceneToDevice, options.style);
+            image.convertTo(QImage::Format_RGB888);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.push_back({ rect, std::move(image) });
+            }
+            finished.notify_one();
+        };
+
+    // a few tiles per thread are handed out ahead, the next ones only when these are written
+    auto maxInFlight = 2 * std::max(pool.maxThreadCount(), 1);
+    auto inFlight = 0;
+    qint64 submitted = 0;
+    auto ok = true;
+    auto cancelled = false;
+    while (inFlight > 0 || (ok && !cancelled && submitted < total))
+    {
+        for (; ok && !cancelled && submitted < total && inFlight < maxInFlight; ++submitted, ++inFlight)
+        {
+            auto rect = QRect(int(submitted % columns) * tileSize, int(submitted / columns) * tileSize,
+                tileSize, tileSize) & QRect(QPoint(), size);
+            pool.start([render, rect]() { render(rect); });
+        }
+        m_stats.peakTiles = std::max(m_stats.peakTiles, inFlight);
+
+        Tile tile;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&done]() { return !done.empty(); });
+            tile = std::move(done.front());
+            done.pop_front();
+        }
+        --inFlight;
+
+        if (!ok || cancelled)
+            continue;
+
+        ok = writeTile(file, header.size(), rowBytes, tile);
+        ++m_stats.tiles;
+        if (m_progress && !m_progress(m_stats.tiles, total))
+            cancelled = true;
+    }
+
+    if (cancelled)
+    {
+        file.cancelWriting();
+        return fail(error, QStringLiteral("The export was cancelled"));
+    }
+    if (!ok || !file.commit())
+        return fail(error, file.errorString());
+
+    return true;
+}
+
+PosterExport::Stats PosterExport::GetStats() const
+{
+    return m_stats;
+}
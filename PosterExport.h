@@ -0,0 +1,59 @@
+#pragma once
+
+#include <functional>
+
+#include <QColor>
+#include <QRectF>
+#include <QSize>
+#include <QString>
+
+#include "DrawableActor.h"
+#include "SceneRasterizer.h"
+
+// Exports a part of the scene at print resolution into a PAM file (P7, RGB) without
+// holding the whole image. Tiles are drawn with the shapes' own Draw on the threads of
+// a pool, each with a painter and an image of its own, and every finished tile is
+// written into its rows of the file. Only a few tiles per thread are alive at a time,
+// however large the output is. The scene must not change while it is exported, see
+// DrawablesScene::FreezeScope.
+class PosterExport
+{
+    public:
+    // scene units per inch at zoom level 0
+    static constexpr double ScreenDpi = 96.;
+
+    // called on the exporting thread after every written tile, returning false cancels
+    using ProgressHandler = std::function<bool(qint64 done, qint64 total)>;
+
+    struct Options
+    {
+        QRectF sceneRect;
+        // output pixels per scene unit, dpi / ScreenDpi
+        double scale = 1.;
+        int tileSize = 512;
+        // 0 is one thread per core
+        int threads = 0;
+        QColor background = Qt::white;
+        PaintStyle style;
+    };
+
+    struct Stats
+    {
+        QSize size;
+        qint64 tiles = 0;
+        // tiles rendered or waiting to be written at the same time
+        int peakTiles = 0;
+        qint64 bytes = 0;
+    };
+
+    PosterExport(DrawableActor const& drawableActor);
+    void SetProgressHandler(ProgressHandler handler);
+    // a cancelled or failed export leaves no file behind
+    bool Export(QString const& fileName, Options const& options, QString* error = nullptr);
+    Stats GetStats() const;
+
+    private:
+    DrawableActor const& m_drawableActor;
+    ProgressHandler m_progress;
+    Stats m_stats;
+};
@@ -0,0 +1,272 @@
+#include <algorithm>
+
+#include <QFile>
+#include <QSaveFile>
+
+#include "DrawablesInit.h"
+#include "SceneFile.h"
+
+namespace
+{
+    constexpr quint64 TableAlignment = 8;
+
+    quint64 aligned(quint64 offset)
+    {
+        return (offset + TableAlignment - 1) / TableAlignment * TableAlignment;
+    }
+
+    bool fail(QString* error, QString const& message)
+    {
+        if (error != nullptr)
+            *error = message;
+        return false;
+    }
+
+    SceneFile::RectRecord rectRecord(quint32 order, quint32 flags, IntRect const& rect)
+    {
+        auto centre = rect.GetPosition();
+        auto diaVecA = rect.DiagonalA();
+        auto diaVecB = rect.DiagonalB();
+        return { order, flags, { centre.x(), centre.y() },
+            { diaVecA.x(), diaVecA.y() }, { diaVecB.x(), diaVecB.y() } };
+    }
+
+    QVector2D toVector2D(float const (&xy)[2])
+    {
+        return QVector2D(xy[0], xy[1]);
+    }
+
+    // the records of a table straight from the mapped file, an empty span if the
+    // file has no such table and valid is cleared if the entry does not fit the file
+    template<typename Record>
+    std::span<Record const> table(uchar const* data, quint64 size,
+        std::span<SceneFile::TableEntry const> entries, SceneFile::Table type, bool& valid)
+    {
+        auto entry = std::find_if(entries.begin(), entries.end(),
+            [type](SceneFile::TableEntry const& e) { return e.type == type; });
+        if (entry == entries.end())
+            return {};
+
+        if (entry->offset % alignof(Record) != 0 || entry->offset > size ||
+            entry->bytes > size - entry->offset || entry->bytes != quint64(entry->count) * sizeof(Record))
+        {
+            valid = false;
+            return {};
+        }
+
+        return { reinterpret_cast<Record const*>(data + entry->offset), entry->count };
+    }
+}
+
+bool SceneFile::Save(QString const& fileName, std::span<NodeModelRepPtr const> shapes, QString* error)
+{
+    std::vector<RectRecord> rects;
+    std::vector<RectRecord> ellipses;
+    std::vector<TextRecord> texts;
+    std::vector<VectorRecord> vectors;
+    std::vector<NodeRecord> nodes;
+    QString textData;
+    std::vector<double> zOrders;
+
+    quint32 order = 0;
+    for (auto const& shape : shapes)
+    {
+        auto model = shape->GetModel();
+        auto flags = model->IsSelected() ? quint32(Selected) : 0u;
+
+        if (auto text = dynamic_cast<TextRep const*>(shape.get()))
+        {
+            auto content = text->GetText();
+            texts.push_back({ rectRecord(order, flags, static_cast<IntRect const&>(*model)),
+                quint32(textData.size()), quint32(content.size()) });
+            textData += content;
+        }
+        else if (auto rect = dynamic_cast<RectRep const*>(shape.get()))
+        {
+            rects.push_back(rectRecord(order, flags, *rect->m_rect));
+        }
+        else if (auto ellipse = dynamic_cast<EllipseRep const*>(shape.get()))
+        {
+            ellipses.push_back(rectRecord(order, flags, *ellipse->m_rect));
+        }
+        else if (dynamic_cast<VectorRep const*>(shape.get()) != nullptr)
+        {
+            auto const& vector = static_cast<IntVector const&>(*model);
+            auto nodeA = vector.m_nodeA->GetPosition();
+            auto nodeB = vector.m_nodeB->GetPosition();
+            vectors.push_back({ order, flags, { nodeA.x(), nodeA.y() }, { nodeB.x(), nodeB.y() } });
+        }
+        else if (dynamic_cast<IntNodeRep const*>(shape.get()) != nullptr)
+        {
+            auto pos = static_cast<IntNode const&>(*model).m_node->GetPosition();
+            nodes.push_back({ order, flags, { pos.x(), pos.y() } });
+        }
+        else
+        {
+            continue;
+        }
+        zOrders.push_back(model->GetZOrder());
+        ++order;
+    }
+
+    struct Chunk
+    {
+        Table type;
+        size_t count;
+        std::span<std::byte const> bytes;
+    };
+    Chunk const chunks[] = {
+        { Table::Rects, rects.size(), std::as_bytes(std::span(rects)) },
+        { Table::Ellipses, ellipses.size(), std::as_bytes(std::span(ellipses)) },
+        { Table::Texts, texts.size(), std::as_bytes(std::span(texts)) },
+        { Table::Vectors, vectors.size(), std::as_bytes(std::span(vectors)) },
+        { Table::Nodes, nodes.size(), std::as_bytes(std::span(nodes)) },
+        { Table::TextData, size_t(textData.size()),
+            std::as_bytes(std::span(textData.utf16(), size_t(textData.size()))) },
+        { Table::ZOrders, zOrders.size(), std::as_bytes(std::span(zOrders)) },
+    };
+
+    Header header{ Magic, Version, order, quint32(std::size(chunks)), 0 };
+    std::vector<TableEntry> entries;
+    auto offset = aligned(sizeof(Header) + std::size(chunks) * sizeof(TableEntry));
+    for (auto const& chunk : chunks)
+    {
+        entries.push_back({ chunk.type, quint32(chunk.count), offset, chunk.bytes.size() });
+        offset = aligned(offset + chunk.bytes.size());
+    }
+    header.fileSize = offset;
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(error, file.errorString());
+
+    auto write = [&file](void const* data, quint64 bytes)
+        {
+            return file.write(static_cast<char const*>(data), qint64(bytes)) == qint64(bytes);
+        };
+
+    auto ok = write(&header, sizeof(Header)) &&
+        write(entries.data(), entries.size() * sizeof(TableEntry));
+    char const padding[TableAlignment] = {};
+    for (size_t i = 0; ok && i < entries.size(); ++i)
+    {
+        ok = write(padding, entries[i].offset - quint64(file.pos())) &&
+            write(chunks[i].bytes.data(), chunks[i].bytes.size());
+    }
+    ok = ok && write(padding, header.fileSize - quint64(file.pos()));
+
+    if (!ok || !file.commit())
+        return fail(error, file.errorString());
+
+    return true;
+}
+
+std::optional<std::vector<SceneFile::NodeModelRepPtr>> SceneFile::Load(QString const& fileName,
+    QString* error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        fail(error, file.errorString());
+        return std::nullopt;
+    }
+
+    auto size = quint64(file.size());
+    auto data = size >= sizeof(Header) ? file.map(0, file.size()) : nullptr;
+    if (data == nullptr)
+    {
+        fail(error, QStringLiteral("%1 is not a scene file").arg(fileName));
+        return std::nullopt;
+    }
+
+    // the mapping goes with the file
+    auto const& header = *reinterpret_cast<Header const*>(data);
+    if (header.magic != Magic || header.fileSize != size ||
+        header.tableCount > (size - sizeof(Header)) / sizeof(TableEntry))
+    {
+        fail(error, QStringLiteral("%1 is not a scene file").arg(fileName));
+        return std::nullopt;
+    }
+    if (header.version > Version)
+    {
+        fail(error, QStringLiteral("%1 is of the newer version %2").arg(fileName).arg(header.version));
+        return std::nullopt;
+    }
+
+    auto valid = true;
+    auto entries = std::span(reinterpret_cast<TableEntry const*>(data + sizeof(Header)), header.tableCount);
+    auto rects = table<RectRecord>(data, size, entries, Table::Rects, valid);
+    auto ellipses = table<RectRecord>(data, size, entries, Table::Ellipses, valid);
+    auto texts = table<TextRecord>(data, size, entries, Table::Texts, valid);
+    auto vectors = table<VectorRecord>(data, size, entries, Table::Vectors, valid);
+    auto nodes = table<NodeRecord>(data, size, entries, Table::Nodes, valid);
+    auto textData = table<char16_t>(data, size, entries, Table::TextData, valid);
+    auto zOrders = table<double>(data, size, entries, Table::ZOrders, valid);
+
+    auto records = rects.size() + ellipses.size() + texts.size() + vectors.size() + nodes.size();
+    if (!valid || records != header.shapeCount || (!zOrders.empty() && zOrders.size() != records))
+    {
+        fail(error, QStringLiteral("%1 is damaged").arg(fileName));
+        return std::nullopt;
+    }
+
+    std::vector<NodeModelRepPtr> shapes(header.shapeCount);
+    auto place = [&shapes, &valid](quint32 order, quint32 flags, NodeModelRepPtr shape)
+        {
+            if (order >= shapes.size() || shapes[order] != nullptr)
+            {
+                valid = false;
+                return;
+            }
+            shape->GetModel()->SetSelected((flags & Selected) != 0);
+            shapes[order] = std::move(shape);
+        };
+
+    for (auto const& rect : rects)
+    {
+        place(rect.order, rect.flags, DrawablesInit::InitRect(
+            toVector2D(rect.centre), toVector2D(rect.diaVecA), toVector2D(rect.diaVecB)));
+    }
+
+    for (auto const& ellipse : ellipses)
+    {
+        place(ellipse.order, ellipse.flags, DrawablesInit::InitEllipse(
+            toVector2D(ellipse.centre), toVector2D(ellipse.diaVecA), toVector2D(ellipse.diaVecB)));
+    }
+
+    for (auto const& text : texts)
+    {
+        if (text.textOffset > textData.size() || text.textLength > textData.size() - text.textOffset)
+        {
+            valid = false;
+            break;
+        }
+
+        auto content = QString(reinterpret_cast<QChar const*>(textData.data() + text.textOffset),
+            qsizetype(text.textLength));
+        auto const& rect = text.rect;
+        place(rect.order, rect.flags, DrawablesInit::InitText(content,
+            toVector2D(rect.centre), toVector2D(rect.diaVecA), toVector2D(rect.diaVecB)));
+    }
+
+    for (auto const& line : vectors)
+    {
+        place(line.order, line.flags, DrawablesInit::InitLine(
+            toVector2D(line.nodeA).toPointF(), toVector2D(line.nodeB).toPointF()));
+    }
+
+    for (auto const& node : nodes)
+        place(node.order, node.flags, DrawablesInit::InitNode(toVector2D(node.pos).toPointF()));
+
+    // every drawing order has to be taken exactly once
+    if (!valid || std::find(shapes.cbegin(), shapes.cend(), nullptr) != shapes.cend())
+    {
+        fail(error, QStringLiteral("%1 is damaged").arg(fileName));
+        return std::nullopt;
+    }
+
+    for (size_t i = 0; i < zOrders.size(); ++i)
+        shapes[i]->GetModel()->SetZOrder(zOrders[i]);
+
+    return shapes;
+}
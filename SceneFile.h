@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <QString>
+
+#include "drawables.h"
+
+// Versioned binary scene file. A fixed layout header is followed by an index of
+// the tables and the tables themselves, each an array of fixed size records at
+// an 8 byte aligned offset. The file is read through a memory map and the shapes
+// are built straight from the mapped records, nothing is parsed.
+//
+//   Header | TableEntry[tableCount] | table | table | ...
+//
+// Every record carries the drawing order of its shape, so the loaded shapes are
+// returned back to front. The optional ZOrders table keeps the z-order of every
+// shape by drawing order, for shapes that are inserted among others later. The numbers are stored in the byte order of the writer,
+// a file of the other byte order is rejected by its magic.
+class SceneFile
+{
+    public:
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+
+    static constexpr quint32 Magic = 0x53444e49; // "INDS"
+    static constexpr quint32 Version = 1;
+
+    enum class Table : quint32 {
+        Rects = 1, Ellipses, Texts, Vectors, Nodes, TextData, ZOrders
+    };
+
+    enum Flag : quint32 {
+        Selected = 1
+    };
+
+    struct Header
+    {
+        quint32 magic;
+        quint32 version;
+        quint32 shapeCount;
+        quint32 tableCount;
+        quint64 fileSize;
+    };
+
+    struct TableEntry
+    {
+        Table type;
+        quint32 count;
+        quint64 offset;
+        quint64 bytes;
+    };
+
+    // rects and ellipses, as IntRect keeps them
+    struct RectRecord
+    {
+        quint32 order;
+        quint32 flags;
+        float centre[2];
+        float diaVecA[2];
+        float diaVecB[2];
+    };
+
+    // the text is a range of UTF-16 units of the TextData table
+    struct TextRecord
+    {
+        RectRecord rect;
+        quint32 textOffset;
+        quint32 textLength;
+    };
+
+    struct VectorRecord
+    {
+        quint32 order;
+        quint32 flags;
+        float nodeA[2];
+        float nodeB[2];
+    };
+
+    struct NodeRecord
+    {
+        quint32 order;
+        quint32 flags;
+        float pos[2];
+    };
+
+    // writes the shapes in the given drawing order with their z-orders, paths are not stored yet
+    static bool Save(QString const& fileName, std::span<NodeModelRepPtr const> shapes,
+        QString* error = nullptr);
+    // the shapes back to front with their stored z-orders, nothing if the file could not be read
+    static std::optional<std::vector<NodeModelRepPtr>> Load(QString const& fileName,
+        QString* error = nullptr);
+};
+
+static_assert(sizeof(SceneFile::Header) == 24);
+static_assert(sizeof(SceneFile::TableEntry) == 24);
+static_assert(sizeof(SceneFile::RectRecord) == 32);
+static_assert(sizeof(SceneFile::TextRecord) == 40);
+static_assert(sizeof(SceneFile::VectorRecord) == 24);
+static_assert(sizeof(SceneFile::NodeRecord) == 16);
@@ -0,0 +1,239 @@
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <typeinfo>
+#include <vector>
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "DrawablesInit.h"
+#include "SceneFile.h"
+
+// Round trip of SceneFile record by record, and files that Load has to reject.
+class SceneFileTest : public QObject
+{
+    Q_OBJECT
+
+    private slots:
+    void initTestCase();
+    void roundTrip();
+    void emptyScene();
+    void rejectsBadMagic();
+    void rejectsTruncatedTable();
+    void rejectsOverlappingOrders();
+    void rejectsMissingOrders();
+
+    private:
+    using NodeModelRepPtr = SceneFile::NodeModelRepPtr;
+
+    // a rotated rect, an ellipse, a text, a line and a node, back to front
+    static std::vector<NodeModelRepPtr> sampleShapes();
+    QByteArray saved(std::vector<NodeModelRepPtr> const& shapes);
+    std::optional<std::vector<NodeModelRepPtr>> load(QByteArray const& bytes, QString* error = nullptr);
+
+    QTemporaryDir m_dir;
+};
+
+namespace
+{
+    template<typename T>
+    T read(QByteArray const& bytes, qsizetype offset)
+    {
+        T value;
+        std::memcpy(&value, bytes.constData() + offset, sizeof(T));
+        return value;
+    }
+
+    template<typename T>
+    void write(QByteArray& bytes, qsizetype offset, T const& value)
+    {
+        std::memcpy(bytes.data() + offset, &value, sizeof(T));
+    }
+
+    SceneFile::TableEntry entryOf(QByteArray const& bytes, SceneFile::Table type)
+    {
+        auto header = read<SceneFile::Header>(bytes, 0);
+        for (quint32 i = 0; i < header.tableCount; ++i)
+        {
+            auto entry = read<SceneFile::TableEntry>(bytes,
+                sizeof(SceneFile::Header) + i * sizeof(SceneFile::TableEntry));
+            if (entry.type == type)
+                return entry;
+        }
+        return {};
+    }
+
+    // the drawing order is the first field of every record
+    void setOrder(QByteArray& bytes, SceneFile::Table type, quint32 order)
+    {
+        auto entry = entryOf(bytes, type);
+        QVERIFY(entry.count > 0);
+        write(bytes, qsizetype(entry.offset), order);
+    }
+}
+
+void SceneFileTest::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+std::vector<SceneFileTest::NodeModelRepPtr> SceneFileTest::sampleShapes()
+{
+    std::vector<NodeModelRepPtr> shapes{
+        DrawablesInit::InitRect(QVector2D(10.f, 20.f), QVector2D(30.f, 40.f), QVector2D(48.f, -14.f)),
+        DrawablesInit::InitEllipse(QRectF(100., 50., 40., 20.)),
+        DrawablesInit::InitText(QPointF(-30., 70.), QString::fromUtf8("Grüße, ∑")),
+        DrawablesInit::InitLine(QPointF(1.5, 2.25), QPointF(-8., 13.)),
+        DrawablesInit::InitNode(QPointF(7., -3.)),
+    };
+
+    double const zOrders[] = { -4.5, 0., 2., 3.25, 10. };
+    for (size_t i = 0; i < shapes.size(); ++i)
+    {
+        shapes[i]->GetModel()->SetZOrder(zOrders[i]);
+        shapes[i]->GetModel()->SetSelected(i % 2 == 0);
+    }
+    return shapes;
+}
+
+QByteArray SceneFileTest::saved(std::vector<NodeModelRepPtr> const& shapes)
+{
+    auto fileName = m_dir.filePath("saved.idscene");
+    QString error;
+    if (!SceneFile::Save(fileName, shapes, &error))
+    {
+        qWarning() << error;
+        return {};
+    }
+
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+std::optional<std::vector<SceneFileTest::NodeModelRepPtr>> SceneFileTest::load(QByteArray const& bytes,
+    QString* error)
+{
+    auto fileName = m_dir.filePath("edited.idscene");
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bytes) != bytes.size())
+        return std::nullopt;
+    file.close();
+
+    return SceneFile::Load(fileName, error);
+}
+
+void SceneFileTest::roundTrip()
+{
+    auto shapes = sampleShapes();
+    auto bytes = saved(shapes);
+    QVERIFY(!bytes.isEmpty());
+
+    QString error;
+    auto loaded = load(bytes, &error);
+    QVERIFY2(loaded.has_value(), qPrintable(error));
+    QCOMPARE(loaded->size(), shapes.size());
+
+    for (size_t i = 0; i < shapes.size(); ++i)
+    {
+        auto const& a = *shapes[i];
+        auto const& b = *(*loaded)[i];
+        QCOMPARE(typeid(b).name(), typeid(a).name());
+
+        auto modelA = a.GetModel();
+        auto modelB = b.GetModel();
+        QCOMPARE(modelB->IsSelected(), modelA->IsSelected());
+        QCOMPARE(modelB->GetZOrder(), modelA->GetZOrder());
+
+        if (auto rectA = std::dynamic_pointer_cast<IntRect>(modelA))
+        {
+            auto rectB = std::static_pointer_cast<IntRect>(modelB);
+            QCOMPARE(rectB->GetPosition(), rectA->GetPosition());
+            QCOMPARE(rectB->DiagonalA(), rectA->DiagonalA());
+            QCOMPARE(rectB->DiagonalB(), rectA->DiagonalB());
+        }
+        else if (auto vectorA = std::dynamic_pointer_cast<IntVector>(modelA))
+        {
+            auto vectorB = std::static_pointer_cast<IntVector>(modelB);
+            QCOMPARE(vectorB->m_nodeA->GetPosition(), vectorA->m_nodeA->GetPosition());
+            QCOMPARE(vectorB->m_nodeB->GetPosition(), vectorA->m_nodeB->GetPosition());
+        }
+        else
+        {
+            auto nodeA = std::dynamic_pointer_cast<IntNode>(modelA);
+            QVERIFY(nodeA != nullptr);
+            QCOMPARE(std::static_pointer_cast<IntNode>(modelB)->m_node->GetPosition(),
+                nodeA->m_node->GetPosition());
+        }
+
+        if (auto textA = dynamic_cast<TextRep const*>(&a))
+            QCOMPARE(static_cast<TextRep const&>(b).GetText(), textA->GetText());
+    }
+}
+
+void SceneFileTest::emptyScene()
+{
+    auto bytes = saved({});
+    QVERIFY(!bytes.isEmpty());
+
+    auto loaded = load(bytes);
+    QVERIFY(loaded.has_value());
+    QVERIFY(loaded->empty());
+}
+
+void SceneFileTest::rejectsBadMagic()
+{
+    auto bytes = saved(sampleShapes());
+    write(bytes, 0, SceneFile::Magic + 1);
+
+    QString error;
+    QVERIFY(!load(bytes, &error).has_value());
+    QVERIFY(!error.isEmpty());
+}
+
+// the file ends within the last table, while the header claims the shorter size
+void SceneFileTest::rejectsTruncatedTable()
+{
+    auto bytes = saved(sampleShapes());
+    auto zOrders = entryOf(bytes, SceneFile::Table::ZOrders);
+    QVERIFY(zOrders.count > 0);
+
+    bytes.truncate(qsizetype(zOrders.offset + zOrders.bytes / 2));
+    auto header = read<SceneFile::Header>(bytes, 0);
+    header.fileSize = quint64(bytes.size());
+    write(bytes, 0, header);
+
+    QString error;
+    QVERIFY(!load(bytes, &error).has_value());
+    QVERIFY(!error.isEmpty());
+}
+
+// the ellipse takes the drawing order of the rect
+void SceneFileTest::rejectsOverlappingOrders()
+{
+    auto bytes = saved(sampleShapes());
+    setOrder(bytes, SceneFile::Table::Ellipses, 0);
+
+    QString error;
+    QVERIFY(!load(bytes, &error).has_value());
+    QVERIFY(!error.isEmpty());
+}
+
+void SceneFileTest::rejectsMissingOrders()
+{
+    // the ellipse claims one past the last order, so its own is left empty
+    auto bytes = saved(sampleShapes());
+    setOrder(bytes, SceneFile::Table::Ellipses, quint32(sampleShapes().size()));
+    QVERIFY(!load(bytes).has_value());
+
+    // the header counts one shape more than there are records
+    bytes = saved(sampleShapes());
+    auto header = read<SceneFile::Header>(bytes, 0);
+    ++header.shapeCount;
+    write(bytes, 0, header);
+    QVERIFY(!load(bytes).has_value());
+}
+
+QTEST_MAIN(SceneFileTest)
+#include "SceneFileTest.moc"
@@ -0,0 +1,557 @@
+#include <algorithm>
+#include <cctype>
+#include <iterator>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QTransform>
+#include <QXmlStreamReader>
+
+#include "DrawablesInit.h"
+#include "SceneImporter.h"
+
+namespace
+{
+    using Record = SceneImporter::Record;
+
+    constexpr size_t BatchSize = 4096;
+
+    bool fail(QString* error, QString const& message)
+    {
+        if (error != nullptr)
+            *error = message;
+        return false;
+    }
+
+    // items are collected in batches and every full batch is converted on a pool
+    // thread, or right away for a single thread; the records come out in the order
+    // of the items. A conversion reports a failure through its error argument.
+    template<typename Item, typename Convert>
+    class Pipeline
+    {
+        public:
+        Pipeline(Convert convert, int threads, size_t batchSize = BatchSize) :
+            m_convert(convert),
+            m_batchSize(batchSize),
+            m_serial(threads == 1)
+        {
+            if (threads > 0)
+                m_pool.setMaxThreadCount(threads);
+        }
+
+        void Push(Item item)
+        {
+            m_batch.push_back(std::move(item));
+            if (m_batch.size() == m_batchSize)
+                flush();
+        }
+
+        // nothing if a conversion failed, error tells the first failure
+        std::optional<std::vector<Record>> Finish(QString* error)
+        {
+            flush();
+            m_pool.waitForDone();
+
+            size_t count = 0;
+            for (auto const& result : m_results)
+            {
+                if (!result->error.isEmpty())
+                {
+                    fail(error, result->error);
+                    return std::nullopt;
+                }
+                count += result->records.size();
+            }
+
+            std::vector<Record> records;
+            records.reserve(count);
+            for (auto& result : m_results)
+                std::move(result->records.begin(), result->records.end(), std::back_inserter(records));
+            return records;
+        }
+
+        private:
+        struct Result
+        {
+            std::vector<Record> records;
+            QString error;
+        };
+
+        void flush()
+        {
+            if (m_batch.empty())
+                return;
+
+            auto result = m_results.emplace_back(std::make_unique<Result>()).get();
+            auto work = [batch = std::move(m_batch), result, convert = m_convert]()
+                {
+                    for (auto const& item : batch)
+                    {
+                        if (!convert(item, result->records, result->error))
+                            return;
+                    }
+                };
+            m_batch = {};
+
+            if (m_serial)
+                work();
+            else
+                m_pool.start(std::move(work));
+        }
+
+        Convert m_convert;
+        size_t m_batchSize;
+        bool m_serial;
+        std::vector<Item> m_batch;
+        std::vector<std::unique_ptr<Result>> m_results;
+        QThreadPool m_pool;
+    };
+
+    // a rect of the file, possibly turned or skewed by its transform
+    Record rectRecord(Record::Kind kind, QRectF const& rect, QTransform const& transform)
+    {
+        Record record;
+        record.kind = kind;
+        auto centre = transform.map(rect.center());
+        record.centre = QVector2D(centre);
+        record.diaVecA = QVector2D(transform.map(rect.topLeft()) - centre);
+        record.diaVecB = QVector2D(transform.map(rect.topRight()) - centre);
+        return record;
+    }
+
+    Record lineRecord(QPointF const& from, QPointF const& to, QTransform const& transform)
+    {
+        Record record;
+        record.kind = Record::Kind::Line;
+        record.from = transform.map(from);
+        record.to = transform.map(to);
+        return record;
+    }
+
+    void addPolyline(std::vector<QPointF> const& points, bool closed, QTransform const& transform,
+        std::vector<Record>& records)
+    {
+        for (size_t i = 1; i < points.size(); ++i)
+            records.push_back(lineRecord(points[i - 1], points[i], transform));
+
+        if (closed && points.size() > 2)
+            records.push_back(lineRecord(points.back(), points.front(), transform));
+    }
+
+    //----------------------------------------------------------------
+    //----------------------------------------------------------------
+
+    struct SvgElement
+    {
+        QString name;
+        QXmlStreamAttributes attributes;
+        // the transforms of the enclosing groups
+        QTransform groups;
+        QString text;
+    };
+
+    // lengths in user units, a "px" suffix is allowed
+    double svgNumber(QStringView text, double fallback = 0.)
+    {
+        text = text.trimmed();
+        if (text.endsWith(u"px"))
+            text.chop(2);
+
+        auto ok = false;
+        auto number = text.toDouble(&ok);
+        return ok ? number : fallback;
+    }
+
+    std::vector<double> svgNumbers(QStringView text)
+    {
+        static QRegularExpression const separators(QStringLiteral("[\\s,]+"));
+
+        std::vector<double> numbers;
+        for (auto const& part : text.toString().split(separators, Qt::SkipEmptyParts))
+            numbers.push_back(svgNumber(part));
+        return numbers;
+    }
+
+    QTransform svgTransform(QStringView text)
+    {
+        static QRegularExpression const operation(QStringLiteral("(\\w+)\\s*\\(([^)]*)\\)"));
+
+        // the operations apply right to left, the last one first
+        QTransform transform;
+        auto matches = operation.globalMatch(text);
+        while (matches.hasNext())
+        {
+            auto match = matches.next();
+            auto name = match.capturedView(1);
+            auto args = svgNumbers(match.capturedView(2));
+            auto count = args.size();
+            args.resize(std::max<size_t>(args.size(), 6), 0.);
+
+            QTransform step;
+            if (name == u"matrix")
+                step = QTransform(args[0], args[1], args[2], args[3], args[4], args[5]);
+            else if (name == u"translate")
+                step.translate(args[0], args[1]);
+            else if (name == u"scale")
+                step.scale(args[0], count > 1 ? args[1] : args[0]);
+            else if (name == u"rotate")
+                step.translate(args[1], args[2]).rotate(args[0]).translate(-args[1], -args[2]);
+
+            transform = step * transform;
+        }
+        return transform;
+    }
+
+    bool convertSvg(SvgElement const& element, std::vector<Record>& records, QString&)
+    {
+        auto const& attributes = element.attributes;
+        auto number = [&attributes](char const* name, double fallback = 0.)
+            {
+                return svgNumber(attributes.value(QLatin1String(name)), fallback);
+            };
+        auto transform = svgTransform(attributes.value(u"transform")) * element.groups;
+        auto const& name = element.name;
+
+        if (name == u"rect")
+        {
+            auto rect = QRectF(number("x"), number("y"), number("width"), number("height"));
+            if (!rect.isEmpty())
+                records.push_back(rectRecord(Record::Kind::Rect, rect, transform));
+        }
+        else if (name == u"circle" || name == u"ellipse")
+        {
+            auto rx = name == u"circle" ? number("r") : number("rx");
+            auto ry = name == u"circle" ? rx : number("ry");
+            auto rect = QRectF(number("cx") - rx, number("cy") - ry, 2. * rx, 2. * ry);
+            if (!rect.isEmpty())
+                records.push_back(rectRecord(Record::Kind::Ellipse, rect, transform));
+        }
+        else if (name == u"line")
+        {
+            records.push_back(lineRecord(QPointF(number("x1"), number("y1")),
+                QPointF(number("x2"), number("y2")), transform));
+        }
+        else if (name == u"polyline" || name == u"polygon")
+        {
+            auto numbers = svgNumbers(attributes.value(u"points"));
+            std::vector<QPointF> points;
+            for (size_t i = 0; i + 1 < numbers.size(); i += 2)
+                points.emplace_back(numbers[i], numbers[i + 1]);
+
+            addPolyline(points, name == u"polygon", transform, records);
+        }
+        else if (name == u"text")
+        {
+            // the box of a new text, hanging from the baseline
+            auto record = rectRecord(Record::Kind::Text,
+                QRectF(QPointF(number("x"), number("y")), QSizeF(160., 80.)), transform);
+            record.text = element.text;
+            records.push_back(std::move(record));
+        }
+        return true;
+    }
+
+    //----------------------------------------------------------------
+    //----------------------------------------------------------------
+
+    void convertJson(QJsonValue const& value, std::vector<Record>& records)
+    {
+        auto const shape = value.toObject();
+        auto type = shape["type"].toString();
+        auto selected = shape["selected"].toBool();
+        auto first = records.size();
+
+        if (type == u"rect" || type == u"ellipse" || type == u"text")
+        {
+            auto isText = type == u"text";
+            auto rect = QRectF(shape["x"].toDouble(), shape["y"].toDouble(),
+                shape["width"].toDouble(isText ? 160. : 0.), shape["height"].toDouble(isText ? 80. : 0.));
+            if (rect.isEmpty())
+                return;
+
+            auto centre = rect.center();
+            auto transform = QTransform().translate(centre.x(), centre.y())
+                .rotate(shape["angle"].toDouble()).translate(-centre.x(), -centre.y());
+            auto kind = isText ? Record::Kind::Text : (type == u"rect" ? Record::Kind::Rect : Record::Kind::Ellipse);
+
+            auto record = rectRecord(kind, rect, transform);
+            record.text = shape["text"].toString();
+            records.push_back(std::move(record));
+        }
+        else if (type == u"line")
+        {
+            records.push_back(lineRecord(QPointF(shape["x1"].toDouble(), shape["y1"].toDouble()),
+                QPointF(shape["x2"].toDouble(), shape["y2"].toDouble()), QTransform()));
+        }
+        else if (type == u"polyline")
+        {
+            auto numbers = shape["points"].toArray();
+            std::vector<QPointF> points;
+            for (qsizetype i = 0; i + 1 < numbers.size(); i += 2)
+                points.emplace_back(numbers[i].toDouble(), numbers[i + 1].toDouble());
+
+            addPolyline(points, shape["closed"].toBool(), QTransform(), records);
+        }
+        else if (type == u"node")
+        {
+            Record record;
+            record.kind = Record::Kind::Node;
+            record.from = QPointF(shape["x"].toDouble(), shape["y"].toDouble());
+            records.push_back(std::move(record));
+        }
+
+        for (auto i = first; i < records.size(); ++i)
+            records[i].selected = selected;
+    }
+    // a run of items of the shapes array, as the bytes between two of its commas
+    struct JsonRange
+    {
+        QByteArrayView bytes;
+        // of the first byte in the file, for the errors
+        qsizetype offset = 0;
+    };
+
+    bool convertJsonRange(JsonRange const& range, std::vector<Record>& records, QString& error)
+    {
+        auto items = QByteArray(range.bytes.size() + 2, Qt::Uninitialized);
+        items.front() = '[';
+        std::copy(range.bytes.begin(), range.bytes.end(), items.begin() + 1);
+        items.back() = ']';
+
+        QJsonParseError parseError;
+        auto document = QJsonDocument::fromJson(items, &parseError);
+        if (document.isNull() || document.array().isEmpty())
+        {
+            auto offset = range.offset + std::max(qsizetype(parseError.offset) - 1, qsizetype(0));
+            error = QStringLiteral("at %1: %2").arg(offset)
+                .arg(document.isNull() ? parseError.errorString() : QStringLiteral("a shape is missing"));
+            return false;
+        }
+
+        for (auto const& shape : document.array())
+            convertJson(shape, records);
+        return true;
+    }
+
+    // where the items of the top level "shapes" array are, found by a scan over
+    // strings and brackets that parses nothing, so the items can be parsed apart
+    struct JsonShapes
+    {
+        // after its [ and at its ]
+        qsizetype begin = -1;
+        qsizetype end = -1;
+        // between the items
+        std::vector<qsizetype> commas;
+    };
+
+    std::optional<JsonShapes> findJsonShapes(QByteArrayView data)
+    {
+        JsonShapes shapes;
+        auto depth = 0;
+        auto inString = false;
+        qsizetype stringBegin = 0;
+        QByteArrayView lastString;
+        // a "shapes" key of the top level object was the last thing read
+        auto shapesKey = false;
+        auto inShapes = [&shapes]() { return shapes.begin >= 0 && shapes.end < 0; };
+
+        for (qsizetype i = 0; i < data.size(); ++i)
+        {
+            auto c = data[i];
+            if (inString)
+            {
+                if (c == '\\')
+                {
+                    ++i;
+                }
+                else if (c == '"')
+                {
+                    inString = false;
+                    lastString = data.sliced(stringBegin, i - stringBegin);
+                }
+                continue;
+            }
+
+            switch (c)
+            {
+            case '"':
+                inString = true;
+                stringBegin = i + 1;
+                shapesKey = false;
+                break;
+            case ':':
+                shapesKey = depth == 1 && lastString == "shapes";
+                break;
+            case '[':
+            case '{':
+                ++depth;
+                if (c == '[' && shapesKey && shapes.begin < 0)
+                    shapes.begin = i + 1;
+                shapesKey = false;
+                break;
+            case ']':
+            case '}':
+                if (c == ']' && depth == 2 && inShapes())
+                    shapes.end = i;
+                if (--depth < 0)
+                    return std::nullopt;
+                shapesKey = false;
+                break;
+            case ',':
+                if (depth == 2 && inShapes())
+                    shapes.commas.push_back(i);
+                shapesKey = false;
+                break;
+            }
+        }
+
+        if (depth != 0 || inString || shapes.begin < 0 || shapes.end < 0)
+            return std::nullopt;
+        return shapes;
+    }
+}
+
+std::optional<std::vector<Record>> SceneImporter::Read(QString const& fileName, QString* error, int threads)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        fail(error, file.errorString());
+        return std::nullopt;
+    }
+
+    auto suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == u"svg")
+        return ReadSvg(file.readAll(), error, threads);
+    if (suffix == u"json")
+        return ReadJson(file.readAll(), error, threads);
+
+    fail(error, QStringLiteral("%1 is neither an SVG nor a JSON file").arg(fileName));
+    return std::nullopt;
+}
+
+std::optional<std::vector<Record>> SceneImporter::ReadSvg(QByteArray const& data, QString* error, int threads)
+{
+    Pipeline<SvgElement, decltype(&convertSvg)> pipeline(&convertSvg, threads);
+
+    // the transforms of the open groups, the svg element itself is one of them
+    std::vector<QTransform> groups{ QTransform() };
+    QXmlStreamReader xml(data);
+    while (!xml.atEnd())
+    {
+        auto token = xml.readNext();
+        if (token == QXmlStreamReader::EndElement && (xml.name() == u"g" || xml.name() == u"svg"))
+        {
+            if (groups.size() > 1)
+                groups.pop_back();
+            continue;
+        }
+        if (token != QXmlStreamReader::StartElement)
+            continue;
+
+        auto name = xml.name();
+        if (name == u"g" || name == u"svg")
+        {
+            groups.push_back(svgTransform(xml.attributes().value(u"transform")) * groups.back());
+            continue;
+        }
+
+        // nothing in these is drawn where it is
+        if (name == u"defs" || name == u"clipPath" || name == u"mask" || name == u"pattern" ||
+            name == u"marker" || name == u"symbol")
+        {
+            xml.skipCurrentElement();
+            continue;
+        }
+
+        SvgElement element{ name.toString(), xml.attributes(), groups.back(), QString() };
+        if (name == u"text")
+            element.text = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+        pipeline.Push(std::move(element));
+    }
+
+    auto records = pipeline.Finish(error);
+    if (xml.hasError())
+    {
+        fail(error, QStringLiteral("line %1: %2").arg(xml.lineNumber()).arg(xml.errorString()));
+        return std::nullopt;
+    }
+    return records;
+}
+
+std::optional<std::vector<Record>> SceneImporter::ReadJson(QByteArray const& data, QString* error, int threads)
+{
+    // the document is parsed here without the items of its shapes array,
+    // those are parsed in ranges of BatchSize items on the pool
+    auto shapes = findJsonShapes(data);
+    auto head = shapes ? data.left(shapes->begin) + data.mid(shapes->end) : data;
+
+    QJsonParseError parseError;
+    auto document = QJsonDocument::fromJson(head, &parseError);
+    if (document.isNull())
+    {
+        fail(error, parseError.errorString());
+        return std::nullopt;
+    }
+
+    auto const scene = document.object();
+    if (scene["format"].toString() != u"interactive-drawing" || scene["version"].toInt() > 1)
+    {
+        fail(error, QStringLiteral("not an interactive-drawing scene of version 1"));
+        return std::nullopt;
+    }
+
+    // a valid document that the scan finds no array in has no shapes
+    auto items = shapes ? QByteArrayView(data).sliced(shapes->begin, shapes->end - shapes->begin) : QByteArrayView();
+    if (!shapes || (shapes->commas.empty() &&
+        std::all_of(items.begin(), items.end(), [](char c) { return std::isspace(uchar(c)) != 0; })))
+    {
+        return std::vector<Record>();
+    }
+
+    Pipeline<JsonRange, decltype(&convertJsonRange)> pipeline(&convertJsonRange, threads, 1);
+    auto from = shapes->begin;
+    for (auto i = BatchSize - 1; i < shapes->commas.size(); i += BatchSize)
+    {
+        auto cut = shapes->commas[i];
+        pipeline.Push({ QByteArrayView(data).sliced(from, cut - from), from });
+        from = cut + 1;
+    }
+    pipeline.Push({ QByteArrayView(data).sliced(from, shapes->end - from), from });
+
+    return pipeline.Finish(error);
+}
+
+std::vector<SceneImporter::NodeModelRepPtr> SceneImporter::Build(std::span<Record const> records)
+{
+    std::vector<NodeModelRepPtr> shapes;
+    shapes.reserve(records.size());
+    for (auto const& record : records)
+    {
+        switch (record.kind)
+        {
+        case Record::Kind::Rect:
+            shapes.push_back(DrawablesInit::InitRect(record.centre, record.diaVecA, record.diaVecB));
+            break;
+        case Record::Kind::Ellipse:
+            shapes.push_back(DrawablesInit::InitEllipse(record.centre, record.diaVecA, record.diaVecB));
+            break;
+        case Record::Kind::Text:
+            shapes.push_back(DrawablesInit::InitText(record.text, record.centre, record.diaVecA, record.diaVecB));
+            break;
+        case Record::Kind::Line:
+            shapes.push_back(DrawablesInit::InitLine(record.from, record.to));
+            break;
+        case Record::Kind::Node:
+            shapes.push_back(DrawablesInit::InitNode(record.from));
+            break;
+        }
+        shapes.back()->GetModel()->SetSelected(record.selected);
+    }
+    return shapes;
+}
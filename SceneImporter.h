@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <QByteArray>
+#include <QPointF>
+#include <QString>
+#include <QVector2D>
+
+#include "drawables.h"
+
+// Imports diagrams from an SVG subset (rect, circle, ellipse, line, polyline,
+// polygon and text, nested in groups with transforms) and from the JSON scene
+// schema below. The file is read into plain records first, on the threads of a
+// pool, and the shapes are built from the records on the thread that owns the scene.
+//
+// A JSON file is scanned for the bounds of the items of its shapes array without
+// parsing them, the rest of the document is parsed on the calling thread and the
+// items in ranges of a few thousand on the pool. SVG is tokenised on the calling
+// thread, as the group transforms depend on the elements before, and only the
+// geometry of batches of elements is worked out on the pool while reading goes on.
+//
+//   { "format": "interactive-drawing", "version": 1, "shapes": [
+//       { "type": "rect", "x": 0, "y": 0, "width": 40, "height": 20, "angle": 30 },
+//       { "type": "ellipse", "x": 50, "y": 0, "width": 40, "height": 20 },
+//       { "type": "text", "x": 0, "y": 40, "width": 160, "height": 80, "text": "..." },
+//       { "type": "line", "x1": 0, "y1": 0, "x2": 100, "y2": 100 },
+//       { "type": "polyline", "points": [ 0, 0, 10, 20, 30, 5 ], "closed": false },
+//       { "type": "node", "x": 10, "y": 10, "selected": true } ] }
+class SceneImporter
+{
+    public:
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+
+    // one shape as IntRect, IntVector or IntNode is built from it,
+    // polylines and polygons come as one line per segment
+    struct Record
+    {
+        enum class Kind {
+            Rect, Ellipse, Text, Line, Node
+        };
+
+        Kind kind = Kind::Rect;
+        // rects, ellipses and texts
+        QVector2D centre;
+        QVector2D diaVecA;
+        QVector2D diaVecB;
+        // lines from-to, nodes at from
+        QPointF from;
+        QPointF to;
+        QString text;
+        bool selected = false;
+    };
+
+    // picks the reader by the file suffix, .svg or .json; threads 0 is one per
+    // core, 1 reads everything on the calling thread
+    static std::optional<std::vector<Record>> Read(QString const& fileName, QString* error = nullptr,
+        int threads = 0);
+    static std::optional<std::vector<Record>> ReadSvg(QByteArray const& data, QString* error = nullptr,
+        int threads = 0);
+    static std::optional<std::vector<Record>> ReadJson(QByteArray const& data, QString* error = nullptr,
+        int threads = 0);
+    // the shapes in the order of the records, in the ShapeArena of the open scope
+    static std::vector<NodeModelRepPtr> Build(std::span<Record const> records);
+};
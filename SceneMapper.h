@@ -1,18 +1,36 @@
 #pragma once
 
+#include <span>
+
 #include <QTransform>
 
 class SceneMapper
 {
     public:
+    // the version changes with every new transform, caches built for one transform compare it
     void SetTransform(QTransform const& trans)
     {
+        if (trans == m_mapFromScene)
+            return;
+
         m_mapFromScene = trans;
+        m_mapToScene = trans.inverted();
+        ++m_version;
+    }
+
+    QTransform const& Transform() const
+    {
+        return m_mapFromScene;
+    }
+
+    quint64 Version() const
+    {
+        return m_version;
     }
 
     QPoint MapToScene(QPointF const& point) const
     {
-        return m_mapFromScene.inverted().map(point).toPoint();
+        return m_mapToScene.map(point).toPoint();
     }
 
     QPointF MapFromScene(QPointF const& point) const
@@ -20,6 +38,81 @@ class SceneMapper
         return m_mapFromScene.map(point);
     }
 
+    QRectF MapRectToScene(QRectF const& rect) const
+    {
+        return m_mapToScene.mapRect(rect);
+    }
+
+    QRectF MapRectFromScene(QRectF const& rect) const
+    {
+        return m_mapFromScene.mapRect(rect);
+    }
+
+    // batch versions, mapped has to be at least as long as the input
+    void MapToScene(std::span<QPointF const> points, std::span<QPointF> mapped) const
+    {
+        mapPoints(m_mapToScene, points, mapped);
+    }
+
+    void MapFromScene(std::span<QPointF const> points, std::span<QPointF> mapped) const
+    {
+        mapPoints(m_mapFromScene, points, mapped);
+    }
+
+    void MapRectsToScene(std::span<QRectF const> rects, std::span<QRectF> mapped) const
+    {
+        mapRects(m_mapToScene, rects, mapped);
+    }
+
+    void MapRectsFromScene(std::span<QRectF const> rects, std::span<QRectF> mapped) const
+    {
+        mapRects(m_mapFromScene, rects, mapped);
+    }
+
     private:
+    static void mapPoints(QTransform const& trans,
+        std::span<QPointF const> points, std::span<QPointF> mapped)
+    {
+        if (trans.type() > QTransform::TxShear)
+        {
+            for (size_t i = 0; i < points.size(); ++i)
+                mapped[i] = trans.map(points[i]);
+            return;
+        }
+
+        // affine, spelled out so the loop does not branch on the transform type per point
+        auto m11 = trans.m11(), m12 = trans.m12(), m21 = trans.m21(), m22 = trans.m22();
+        auto dx = trans.dx(), dy = trans.dy();
+        for (size_t i = 0; i < points.size(); ++i)
+        {
+            auto x = points[i].x();
+            auto y = points[i].y();
+            mapped[i] = QPointF(m11 * x + m21 * y + dx, m12 * x + m22 * y + dy);
+        }
+    }
+
+    static void mapRects(QTransform const& trans,
+        std::span<QRectF const> rects, std::span<QRectF> mapped)
+    {
+        if (trans.type() > QTransform::TxScale)
+        {
+            for (size_t i = 0; i < rects.size(); ++i)
+                mapped[i] = trans.mapRect(rects[i]);
+            return;
+        }
+
+        // pan and zoom only, the corners stay corners
+        auto sx = trans.m11(), sy = trans.m22();
+        auto dx = trans.dx(), dy = trans.dy();
+        for (size_t i = 0; i < rects.size(); ++i)
+        {
+            auto const& r = rects[i];
+            mapped[i] = QRectF(QPointF(sx * r.left() + dx, sy * r.top() + dy),
+                QPointF(sx * r.right() + dx, sy * r.bottom() + dy)).normalized();
+        }
+    }
+
     QTransform m_mapFromScene;
+    QTransform m_mapToScene;
+    quint64 m_version = 0;
 };
@@ -0,0 +1,39 @@
+#include "SceneRasterizer.h"
+
+QImage SceneRasterizer::RenderTile(DrawableActor const& drawableActor,
+    QRect const& deviceRect,
+    QTransform const& sceneToDevice,
+    PaintStyle const& style,
+    DrawStats* stats,
+    qreal devicePixelRatio,
+    double aboveZ,
+    double belowZ)
+{
+    QImage tile(deviceRect.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    tile.setDevicePixelRatio(devicePixelRatio);
+    tile.fill(Qt::transparent);
+
+    auto tileStats = Render(drawableActor, tile, deviceRect, sceneToDevice, style, aboveZ, belowZ);
+    if (stats != nullptr)
+        *stats = tileStats;
+
+    return tile;
+}
+
+SceneRasterizer::DrawStats SceneRasterizer::Render(DrawableActor const& drawableActor,
+    QImage& image,
+    QRect const& deviceRect,
+    QTransform const& sceneToDevice,
+    PaintStyle const& style,
+    double aboveZ,
+    double belowZ)
+{
+    QPainter painter(&image);
+    style.Apply(&painter);
+    painter.translate(-deviceRect.topLeft());
+    painter.setTransform(sceneToDevice, true);
+
+    // one pixel of slack for the antialiased outlines
+    auto visibleRect = sceneToDevice.inverted().mapRect(QRectF(deviceRect).adjusted(-1, -1, 1, 1));
+    return drawableActor.DrawAll(&painter, visibleRect, aboveZ, belowZ);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <QImage>
+#include <QPainter>
+#include <QTransform>
+
+#include "DrawableActor.h"
+
+// Pen, brush and render hints the shapes are drawn with
+struct PaintStyle
+{
+    QPen pen;
+    QBrush brush;
+    QPainter::RenderHints hints;
+
+    static PaintStyle Of(QPainter const* painter)
+    {
+        return { painter->pen(), painter->brush(), painter->renderHints() };
+    }
+
+    void Apply(QPainter* painter) const
+    {
+        painter->setPen(pen);
+        painter->setBrush(brush);
+        painter->setRenderHints(hints);
+    }
+
+    bool operator==(PaintStyle const& other) const
+    {
+        return pen == other.pen && brush == other.brush && hints == other.hints;
+    }
+
+    bool operator!=(PaintStyle const& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+class SceneRasterizer
+{
+    public:
+    using DrawStats = DrawableActor::DrawStats;
+
+    // Draws the part of the scene that falls on deviceRect over the image, which covers deviceRect.
+    static DrawStats Render(DrawableActor const& drawableActor,
+        QImage& image,
+        QRect const& deviceRect,
+        QTransform const& sceneToDevice,
+        PaintStyle const& style,
+        double aboveZ = -std::numeric_limits<double>::infinity(),
+        double belowZ = std::numeric_limits<double>::infinity());
+
+    // Renders the part of the scene that falls on deviceRect into a transparent image.
+    // sceneToDevice maps scene coordinates to the device the rect is given in,
+    // only the shapes with aboveZ < z-order < belowZ are drawn.
+    static QImage RenderTile(DrawableActor const& drawableActor,
+        QRect const& deviceRect,
+        QTransform const& sceneToDevice,
+        PaintStyle const& style,
+        DrawStats* stats = nullptr,
+        qreal devicePixelRatio = 1.,
+        double aboveZ = -std::numeric_limits<double>::infinity(),
+        double belowZ = std::numeric_limits<double>::infinity());
+};
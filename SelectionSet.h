@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Set of the selected items. The items are kept contiguous for iteration and
+// a removed item is replaced by the last one, so inserting, removing and
+// looking up an item are all constant time. The order is not kept.
+template <typename T>
+class SelectionSet
+{
+    public:
+    using const_iterator = typename std::vector<T>::const_iterator;
+
+    void Insert(T const& item)
+    {
+        if (m_slots.contains(item))
+            return;
+
+        m_slots.emplace(item, m_items.size());
+        m_items.push_back(item);
+    }
+
+    void Erase(T const& item)
+    {
+        auto slot = m_slots.find(item);
+        if (slot == m_slots.end())
+            return;
+
+        auto index = slot->second;
+        m_slots.erase(slot);
+        if (index + 1 != m_items.size())
+        {
+            m_items[index] = m_items.back();
+            m_slots[m_items[index]] = index;
+        }
+        m_items.pop_back();
+    }
+
+    bool Contains(T const& item) const
+    {
+        return m_slots.contains(item);
+    }
+
+    bool Empty() const
+    {
+        return m_items.empty();
+    }
+
+    size_t Size() const
+    {
+        return m_items.size();
+    }
+
+    void Clear()
+    {
+        m_items.clear();
+        m_slots.clear();
+    }
+
+    // a copy, for the callers that change the selection while walking it
+    std::vector<T> Items() const
+    {
+        return m_items;
+    }
+
+    const_iterator begin() const
+    {
+        return m_items.cbegin();
+    }
+
+    const_iterator end() const
+    {
+        return m_items.cend();
+    }
+
+    private:
+    std::vector<T> m_items;
+    std::unordered_map<T, size_t> m_slots;
+};
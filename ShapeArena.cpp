@@ -0,0 +1,47 @@
+#include "ShapeArena.h"
+
+ShapeArena::Scope::Scope(std::shared_ptr<ShapeArena> const& arena) : m_previous(current())
+{
+    current() = arena;
+}
+
+ShapeArena::Scope::~Scope()
+{
+    current() = std::move(m_previous);
+}
+
+void* ShapeArena::Allocate(size_t bytes, size_t alignment)
+{
+    ++m_allocations;
+    ++m_live;
+    m_liveBytes += bytes;
+    return m_pool.allocate(bytes, alignment);
+}
+
+void ShapeArena::Deallocate(void* ptr, size_t bytes, size_t alignment)
+{
+    --m_live;
+    m_liveBytes -= bytes;
+    m_pool.deallocate(ptr, bytes, alignment);
+}
+
+size_t ShapeArena::Allocations() const
+{
+    return m_allocations;
+}
+
+size_t ShapeArena::LiveAllocations() const
+{
+    return m_live;
+}
+
+size_t ShapeArena::LiveBytes() const
+{
+    return m_liveBytes;
+}
+
+std::shared_ptr<ShapeArena>& ShapeArena::current()
+{
+    thread_local std::shared_ptr<ShapeArena> arena;
+    return arena;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+
+// Pool for the models, nodes and reps of a scene. While a Scope is open on a
+// thread, ShapeArena::Make places the objects together with their shared_ptr
+// control blocks in the pool of that arena instead of on the heap. Every object
+// keeps its arena alive, so the pool is released in one go after the last shape
+// built from it is gone. An arena is meant to be used from one thread at a time.
+class ShapeArena
+{
+    public:
+    template<typename T>
+    class Allocator
+    {
+        public:
+        using value_type = T;
+
+        Allocator(std::shared_ptr<ShapeArena> arena) : m_arena(std::move(arena))
+        {
+        }
+
+        template<typename U>
+        Allocator(Allocator<U> const& other) : m_arena(other.Arena())
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            return static_cast<T*>(m_arena->Allocate(count * sizeof(T), alignof(T)));
+        }
+
+        void deallocate(T* ptr, size_t count)
+        {
+            m_arena->Deallocate(ptr, count * sizeof(T), alignof(T));
+        }
+
+        std::shared_ptr<ShapeArena> const& Arena() const
+        {
+            return m_arena;
+        }
+
+        template<typename U>
+        bool operator==(Allocator<U> const& other) const
+        {
+            return m_arena == other.Arena();
+        }
+
+        private:
+        std::shared_ptr<ShapeArena> m_arena;
+    };
+
+    class Scope
+    {
+        public:
+        Scope(std::shared_ptr<ShapeArena> const& arena);
+        ~Scope();
+
+        private:
+        std::shared_ptr<ShapeArena> m_previous;
+    };
+
+    template<typename T, typename... Args>
+    static std::shared_ptr<T> Make(Args&&... args)
+    {
+        auto const& arena = current();
+        if (arena == nullptr)
+            return std::make_shared<T>(std::forward<Args>(args)...);
+
+        return std::allocate_shared<T>(Allocator<T>(arena), std::forward<Args>(args)...);
+    }
+
+    void* Allocate(size_t bytes, size_t alignment);
+    void Deallocate(void* ptr, size_t bytes, size_t alignment);
+    // blocks handed out in total and the ones not given back yet
+    size_t Allocations() const;
+    size_t LiveAllocations() const;
+    // bytes of the blocks not given back yet
+    size_t LiveBytes() const;
+
+    private:
+    static std::shared_ptr<ShapeArena>& current();
+
+    std::pmr::unsynchronized_pool_resource m_pool;
+    size_t m_allocations = 0;
+    size_t m_live = 0;
+    size_t m_liveBytes = 0;
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QPointF>
+#include <QRectF>
+
+// Loose quadtree keyed by item. Every cell accepts items whose centre lies in
+// the cell and whose half extent is not larger than the cell's half size, so
+// an item is stored in exactly one cell and queries only have to look at the
+// cells along the path to the hits. The root grows on demand.
+template <typename T>
+class SpatialIndex
+{
+    public:
+    void Insert(T const& item, QRectF const& bounds)
+    {
+        auto rect = bounds.normalized();
+        grow(rect);
+
+        auto cell = m_root.get();
+        auto halfExtent = std::max(rect.width(), rect.height()) / 2.;
+        while (cell->halfSize / 2. >= MinHalfSize && halfExtent <= cell->halfSize / 2.)
+        {
+            auto quadrant = quadrantOf(cell, rect.center());
+            auto& child = cell->children[quadrant];
+            if (child == nullptr)
+                child = makeChild(cell, quadrant);
+            cell = child.get();
+        }
+
+        cell->entries.push_back({ item, rect });
+        m_locations[item] = { cell, rect };
+    }
+
+    void Update(T const& item, QRectF const& bounds)
+    {
+        Remove(item);
+        Insert(item, bounds);
+    }
+
+    void Remove(T const& item)
+    {
+        auto location = m_locations.find(item);
+        if (location == m_locations.end())
+            return;
+
+        auto& entries = location->second.cell->entries;
+        auto entry = std::find_if(entries.begin(), entries.end(),
+            [&item](Entry const& e) { return e.item == item; });
+        *entry = entries.back();
+        entries.pop_back();
+        m_locations.erase(location);
+    }
+
+    bool Contains(T const& item) const
+    {
+        return m_locations.find(item) != m_locations.end();
+    }
+
+    QRectF Bounds(T const& item) const
+    {
+        auto location = m_locations.find(item);
+        return location != m_locations.end() ? location->second.bounds : QRectF();
+    }
+
+    // whether the item is one that Query(area) visits
+    bool Intersects(T const& item, QRectF const& area) const
+    {
+        auto location = m_locations.find(item);
+        return location != m_locations.end() && intersects(location->second.bounds, area.normalized());
+    }
+
+    void Clear()
+    {
+        m_root.reset();
+        m_locations.clear();
+    }
+
+    size_t Size() const
+    {
+        return m_locations.size();
+    }
+
+    // visit(item, bounds) is called for every item whose bounds contain pos
+    template <typename Visitor>
+    void Query(QPointF const& pos, Visitor&& visit) const
+    {
+        queryCells(
+            [&pos](QRectF const& r) { return containsPoint(r, pos); },
+            [&](Entry const& entry) {
+                if (containsPoint(entry.bounds, pos))
+                    visit(entry.item, entry.bounds);
+            });
+    }
+
+    // visit(item, bounds) is called for every item whose bounds intersect area
+    template <typename Visitor>
+    void Query(QRectF const& area, Visitor&& visit) const
+    {
+        auto rect = area.normalized();
+        queryCells(
+            [&rect](QRectF const& r) { return intersects(r, rect); },
+            [&](Entry const& entry) {
+                if (intersects(entry.bounds, rect))
+                    visit(entry.item, entry.bounds);
+            });
+    }
+
+    private:
+    static constexpr double MinHalfSize = 8.0;
+    static constexpr double InitialHalfSize = 512.0;
+
+    struct Entry
+    {
+        T item;
+        QRectF bounds;
+    };
+
+    struct Cell;
+
+    struct Location
+    {
+        Cell* cell;
+        QRectF bounds;
+    };
+
+    struct Cell
+    {
+        QPointF centre;
+        double halfSize;
+        std::array<std::unique_ptr<Cell>, 4> children;
+        std::vector<Entry> entries;
+
+        // items may stick out of the cell by up to one half size
+        QRectF LooseBounds() const
+        {
+            auto r = 2. * halfSize;
+            return QRectF(centre - QPointF(r, r), QSizeF(2. * r, 2. * r));
+        }
+    };
+
+    template <typename CellTest, typename EntryVisitor>
+    void queryCells(CellTest&& cellTest, EntryVisitor&& visitEntry) const
+    {
+        if (m_root == nullptr)
+            return;
+
+        std::vector<Cell const*> stack{ m_root.get() };
+        while (!stack.empty())
+        {
+            auto cell = stack.back();
+            stack.pop_back();
+            if (!cellTest(cell->LooseBounds()))
+                continue;
+
+            for (auto const& entry : cell->entries)
+                visitEntry(entry);
+
+            for (auto const& child : cell->children)
+            {
+                if (child != nullptr)
+                    stack.push_back(child.get());
+            }
+        }
+    }
+
+    static bool fits(Cell const* cell, QRectF const& rect)
+    {
+        auto c = rect.center();
+        auto h = cell->halfSize;
+        return std::max(rect.width(), rect.height()) / 2. <= h &&
+            c.x() >= cell->centre.x() - h && c.x() <= cell->centre.x() + h &&
+            c.y() >= cell->centre.y() - h && c.y() <= cell->centre.y() + h;
+    }
+
+    static int quadrantOf(Cell const* cell, QPointF const& pos)
+    {
+        return (pos.x() < cell->centre.x() ? 0 : 1) + (pos.y() < cell->centre.y() ? 0 : 2);
+    }
+
+    static std::unique_ptr<Cell> makeChild(Cell const* parent, int quadrant)
+    {
+        auto child = std::make_unique<Cell>();
+        child->halfSize = parent->halfSize / 2.;
+        child->centre = parent->centre + QPointF(
+            (quadrant & 1) ? child->halfSize : -child->halfSize,
+            (quadrant & 2) ? child->halfSize : -child->halfSize);
+        return child;
+    }
+
+    void grow(QRectF const& rect)
+    {
+        if (m_root == nullptr)
+        {
+            m_root = std::make_unique<Cell>();
+            m_root->centre = rect.center();
+            m_root->halfSize = std::max(InitialHalfSize, std::max(rect.width(), rect.height()));
+        }
+
+        // double the root towards the item until it fits; the old root becomes one quadrant
+        while (!fits(m_root.get(), rect))
+        {
+            auto oldRoot = std::move(m_root);
+            auto target = rect.center();
+            auto h = oldRoot->halfSize;
+
+            m_root = std::make_unique<Cell>();
+            m_root->halfSize = 2. * h;
+            m_root->centre = oldRoot->centre + QPointF(
+                target.x() < oldRoot->centre.x() ? -h : h,
+                target.y() < oldRoot->centre.y() ? -h : h);
+
+            auto quadrant = quadrantOf(m_root.get(), oldRoot->centre);
+            m_root->children[quadrant] = std::move(oldRoot);
+        }
+    }
+
+    // QRectF::contains/intersects treat zero sized rects as empty, items here may be points
+    static bool containsPoint(QRectF const& r, QPointF const& p)
+    {
+        return p.x() >= r.left() && p.x() <= r.right() && p.y() >= r.top() && p.y() <= r.bottom();
+    }
+
+    static bool intersects(QRectF const& a, QRectF const& b)
+    {
+        return a.left() <= b.right() && b.left() <= a.right() &&
+            a.top() <= b.bottom() && b.top() <= a.bottom();
+    }
+
+    std::unique_ptr<Cell> m_root;
+    std::unordered_map<T, Location> m_locations;
+};
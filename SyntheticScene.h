@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <QRandomGenerator>
+
+#include "drawables.h"
+#include "DrawablesInit.h"
+
+// Builds reproducible scenes of rects, ellipses, lines and texts at a constant
+// density, so scenes of different sizes can be compared frame by frame.
+class SyntheticScene
+{
+    public:
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+
+    // scene units per shape along one side of the square the shapes are spread on
+    static constexpr double Spacing = 60.0;
+
+    inline static double SideLength(int count)
+    {
+        return std::ceil(std::sqrt(double(count))) * Spacing;
+    }
+
+    inline static std::vector<NodeModelRepPtr> Generate(int count, quint32 seed = 1)
+    {
+        QRandomGenerator random(seed);
+        auto side = SideLength(count);
+
+        std::vector<NodeModelRepPtr> shapes;
+        shapes.reserve(count);
+        for (auto i = 0; i < count; ++i)
+        {
+            auto pos = QPointF(random.bounded(side), random.bounded(side));
+            auto size = QSizeF(10. + random.bounded(40.), 10. + random.bounded(40.));
+            auto rect = QRectF(pos, size);
+
+            switch (i % 4)
+            {
+            case 0:
+                shapes.push_back(DrawablesInit::InitRect(rect));
+                break;
+            case 1:
+                shapes.push_back(DrawablesInit::InitEllipse(rect));
+                break;
+            case 2:
+                shapes.push_back(DrawablesInit::InitLine(rect.topLeft(), rect.bottomRight()));
+                break;
+            default:
+                shapes.push_back(DrawablesInit::InitText(pos, QString("Text %1").arg(i)));
+                break;
+            }
+
+            shapes.back()->GetModel()->SetSelected(false);
+        }
+        return shapes;
+    }
+};
@@ -1,11 +1,11 @@
 #pragma once
 
-#include <algorithm>
 #include <memory>
-#include <vector>
 
 #include <QObject>
 #include "Drawables.h"
+#include "DrawableActor.h"
+#include "UndoStack.h"
 
 class TextActor : public QObject
 {
@@ -13,10 +13,12 @@ class TextActor : public QObject
     public:
     using TextRepPtr = std::shared_ptr<TextRep>;
     using SceneMapperPtr = std::shared_ptr<SceneMapper>;
+    using DrawableActorPtr = std::shared_ptr<DrawableActor>;
 
-    TextActor(QTextEdit* textEdit, SceneMapperPtr mapper) :
+    TextActor(QTextEdit* textEdit, SceneMapperPtr mapper, DrawableActorPtr drawableActor) :
         m_textEdit(textEdit),
-        m_mapper(mapper)
+        m_mapper(mapper),
+        m_drawableActor(drawableActor)
     {
         m_textEdit->installEventFilter(this);
     }
@@ -34,12 +36,16 @@ class TextActor : public QObject
                 {
                     auto pos = m_mapper->MapToScene(m_textEdit->pos());
                     auto textRep = DrawablesInit::InitText(pos, txt);
-                    m_texts.push_back(textRep);
                     emit TextCreated(textRep);
                 }
                 else
                 {
+                    auto before = m_underEditText->GetText();
                     m_underEditText->SetText(txt);
+                    // the cached tiles under the text still show the old one
+                    m_drawableActor->Repaint(m_underEditText.get());
+                    if (auto undoStack = m_drawableActor->GetUndoStack())
+                        undoStack->RecordText(m_underEditText, before);
                     m_underEditText = nullptr;
                 }
             }
@@ -61,37 +67,40 @@ class TextActor : public QObject
 
     void EditText()
     {
-        auto textIt = std::find_if(m_texts.cbegin(), m_texts.cend(),
-            [](TextRepPtr txt) {return txt->GetModel()->IsSelected(); });
-
-        if (textIt == m_texts.cend())
+        auto textRep = selectedText();
+        if (textRep == nullptr)
             return;
 
-        auto textRep = *textIt;
         m_underEditText = textRep;
         ShowTextEdit(m_mapper->MapFromScene(
             textRep->GetModel()->GetPosition().toPoint()).toPoint());
     }
 
-    void DeleteSelected()
+    signals:
+    void TextCreated(TextRepPtr textRep);
+
+    private:
+    // the topmost of the selected texts
+    TextRepPtr selectedText() const
     {
-        auto selectedText = std::find_if(m_texts.cbegin(), m_texts.cend(),
-            [](const TextRepPtr& txt) {
-                return txt->GetModel()->IsSelected();
-            });
+        NodeModelRep const* topmost = nullptr;
+        for (auto drawable : m_drawableActor->Selection())
+        {
+            if (!drawable->HasText())
+                continue;
 
-        if (selectedText == m_texts.cend())
-            return;
+            if (topmost == nullptr || topmost->GetModel()->GetZOrder() < drawable->GetModel()->GetZOrder())
+                topmost = drawable;
+        }
 
-        m_texts.erase(selectedText);
-    }
+        if (topmost == nullptr)
+            return nullptr;
 
-    signals:
-    void TextCreated(TextRepPtr textRep);
+        return std::dynamic_pointer_cast<TextRep>(m_drawableActor->SharedRep(topmost));
+    }
 
-    private:
-    std::vector<TextRepPtr> m_texts;
     TextRepPtr m_underEditText = nullptr;
     QTextEdit* m_textEdit;
     SceneMapperPtr m_mapper;
+    DrawableActorPtr m_drawableActor;
 };
\ No newline at end of file
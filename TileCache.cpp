@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+
+#include "TileCache.h"
+
+TileCache::TileCache(int maxTiles) : m_maxTiles(maxTiles)
+{
+}
+
+void TileCache::SetStyle(PaintStyle const& style)
+{
+    if (style == m_style)
+        return;
+
+    m_style = style;
+    Clear();
+}
+
+void TileCache::Draw(QPainter* painter, QRect const& deviceRect, QPoint const& origin,
+    int zoomLevel, double scale, RenderFunction const& render)
+{
+    ++m_frame;
+    m_lastStats = Stats();
+    m_levelScales[zoomLevel] = scale;
+    auto ratio = painter->device()->devicePixelRatioF();
+
+    // deviceRect in zoomed scene coordinates
+    auto zoomed = deviceRect.translated(-origin);
+    auto fromX = static_cast<int>(std::floor(zoomed.left() / double(TileSize)));
+    auto toX = static_cast<int>(std::floor(zoomed.right() / double(TileSize)));
+    auto fromY = static_cast<int>(std::floor(zoomed.top() / double(TileSize)));
+    auto toY = static_cast<int>(std::floor(zoomed.bottom() / double(TileSize)));
+
+    for (auto y = fromY; y <= toY; ++y)
+    {
+        for (auto x = fromX; x <= toX; ++x)
+        {
+            auto tileRect = QRect(x * TileSize, y * TileSize, TileSize, TileSize);
+            auto& tile = m_tiles[TileKey{ zoomLevel, ratio, x, y }];
+            if (tile.image.isNull())
+            {
+                tile.image = render(tileRect, ratio);
+                ++m_lastStats.rendered;
+            }
+            else
+            {
+                ++m_lastStats.hits;
+            }
+
+            tile.lastUse = m_frame;
+            painter->drawImage(tileRect.topLeft() + origin, tile.image);
+        }
+    }
+
+    evict();
+    m_lastStats.cached = static_cast<int>(m_tiles.size());
+}
+
+void TileCache::Invalidate(QRectF const& sceneRect)
+{
+    if (sceneRect.isNull())
+        return;
+
+    // there are only a few hundred tiles, testing each is cheaper than walking
+    // the tile range of a large rect at a high zoom level
+    for (auto it = m_tiles.begin(); it != m_tiles.end();)
+    {
+        auto scale = m_levelScales[it->first.zoomLevel];
+        auto tileRect = QRectF(it->first.x * TileSize, it->first.y * TileSize, TileSize, TileSize);
+
+        // a couple of pixels for the antialiased outlines
+        auto zoomed = QRectF(sceneRect.topLeft() * scale, sceneRect.bottomRight() * scale)
+            .adjusted(-2, -2, 2, 2);
+
+        if (zoomed.intersects(tileRect))
+            it = m_tiles.erase(it);
+        else
+            ++it;
+    }
+}
+
+void TileCache::Clear()
+{
+    m_tiles.clear();
+    m_levelScales.clear();
+}
+
+TileCache::Stats TileCache::LastStats() const
+{
+    return m_lastStats;
+}
+
+void TileCache::evict()
+{
+    if (static_cast<int>(m_tiles.size()) <= m_maxTiles)
+        return;
+
+    // drop the least recently composited tiles
+    std::vector<quint64> uses;
+    uses.reserve(m_tiles.size());
+    for (auto const& entry : m_tiles)
+        uses.push_back(entry.second.lastUse);
+
+    auto excess = uses.size() - m_maxTiles;
+    std::nth_element(uses.begin(), uses.begin() + excess - 1, uses.end());
+    auto threshold = std::min(uses[excess - 1], m_frame - 1);
+
+    for (auto it = m_tiles.begin(); it != m_tiles.end();)
+    {
+        if (it->second.lastUse <= threshold)
+            it = m_tiles.erase(it);
+        else
+            ++it;
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <unordered_map>
+
+#include <QHash>
+#include <QImage>
+#include <QPainter>
+
+#include "SceneRasterizer.h"
+
+// Caches the rasterised scene in fixed size tiles keyed by (zoom level, device pixel ratio,
+// tile x, tile y). Tiles are laid out in zoomed scene coordinates (scene position * scale),
+// so panning only changes where they are composited, not their content. A tile holds
+// TileSize * ratio pixels, so it stays sharp on HiDPI screens.
+class TileCache
+{
+    public:
+    static constexpr int TileSize = 256;
+
+    // renders the given rect of zoomed scene coordinates at the given device pixel ratio
+    using RenderFunction = std::function<QImage(QRect const& zoomedRect, qreal devicePixelRatio)>;
+
+    struct Stats
+    {
+        int hits = 0;
+        int rendered = 0;
+        int cached = 0;
+    };
+
+    TileCache(int maxTiles = 512);
+    void SetStyle(PaintStyle const& style);
+    void Draw(QPainter* painter, QRect const& deviceRect, QPoint const& origin,
+        int zoomLevel, double scale, RenderFunction const& render);
+    void Invalidate(QRectF const& sceneRect);
+    void Clear();
+    Stats LastStats() const;
+
+    private:
+    struct TileKey
+    {
+        int zoomLevel;
+        qreal devicePixelRatio;
+        int x;
+        int y;
+
+        bool operator==(TileKey const& other) const
+        {
+            return zoomLevel == other.zoomLevel && devicePixelRatio == other.devicePixelRatio &&
+                x == other.x && y == other.y;
+        }
+    };
+
+    struct TileKeyHash
+    {
+        size_t operator()(TileKey const& key) const
+        {
+            return qHashMulti(0, key.zoomLevel, key.devicePixelRatio, key.x, key.y);
+        }
+    };
+
+    struct Tile
+    {
+        QImage image;
+        quint64 lastUse = 0;
+    };
+
+    void evict();
+
+    int m_maxTiles;
+    quint64 m_frame = 0;
+    PaintStyle m_style;
+    std::unordered_map<TileKey, Tile, TileKeyHash> m_tiles;
+    std::map<int, double> m_levelScales;
+    Stats m_lastStats;
+};
@@ -0,0 +1,301 @@
+#include <algorithm>
+#include <functional>
+
+#include "DrawableActor.h"
+#include "UndoStack.h"
+
+namespace
+{
+    // a rough size of a shape with its model and nodes, removed shapes live on in the history
+    constexpr size_t RetainedShapeBytes = 1024;
+}
+
+UndoStack::UndoStack(DrawableActor& drawableActor, size_t memoryCap) :
+    m_drawableActor(drawableActor),
+    m_memoryCap(memoryCap)
+{
+}
+
+void UndoStack::BeginGrab()
+{
+    m_grab = ++m_grabs;
+}
+
+void UndoStack::EndGrab()
+{
+    m_grab = 0;
+}
+
+void UndoStack::RecordInsert(std::span<NodeModelRepPtr const> shapes)
+{
+    if (!shapes.empty())
+        record(Insertion{ { shapes.begin(), shapes.end() } });
+}
+
+void UndoStack::RecordRemove(std::span<NodeModelRepPtr const> shapes)
+{
+    if (!shapes.empty())
+        record(Removal{ { shapes.begin(), shapes.end() } });
+}
+
+void UndoStack::RecordMove(std::vector<NodeModelRepPtr> shapes, QVector2D const& delta)
+{
+    if (!shapes.empty() && !delta.isNull())
+        record(Move{ std::move(shapes), delta });
+}
+
+void UndoStack::RecordGeometry(NodeModelRepPtr const& shape, std::span<QVector2D const> before)
+{
+    auto after = shape->GetModel()->GetGeometry();
+    if (after.size() != before.size() || after.empty())
+        return;
+
+    std::vector<QVector2D> diffs(after.size());
+    std::transform(after.cbegin(), after.cend(), before.begin(), diffs.begin(), std::minus<QVector2D>());
+
+    // a shape that was dragged as a whole only needs the one vector
+    auto first = diffs.front();
+    if (std::all_of(diffs.cbegin(), diffs.cend(), [&first](QVector2D const& diff) { return diff == first; }))
+        RecordMove({ shape }, first);
+    else
+        record(Reshape{ shape, std::move(diffs) });
+}
+
+void UndoStack::RecordZOrders(std::vector<NodeModelRepPtr> shapes, std::vector<double> before)
+{
+    if (shapes.empty() || shapes.size() != before.size())
+        return;
+
+    std::vector<double> after;
+    after.reserve(shapes.size());
+    for (auto const& shape : shapes)
+        after.push_back(shape->GetModel()->GetZOrder());
+
+    record(Reorder{ std::move(shapes), std::move(before), std::move(after) });
+}
+
+void UndoStack::RecordText(TextRepPtr const& text, QString const& before)
+{
+    auto after = text->GetText();
+    if (after != before)
+        record(TextEdit{ text, before, after });
+}
+
+bool UndoStack::Undo()
+{
+    if (m_next == 0)
+        return false;
+
+    EndGrab();
+    auto const& entry = m_entries[--m_next];
+    m_applying = true;
+    {
+        DrawableActor::UpdateScope scope(m_drawableActor);
+        for (auto change = entry.changes.crbegin(); change != entry.changes.crend(); ++change)
+            apply(*change, true);
+    }
+    m_applying = false;
+    return true;
+}
+
+bool UndoStack::Redo()
+{
+    if (m_next == m_entries.size())
+        return false;
+
+    EndGrab();
+    auto const& entry = m_entries[m_next++];
+    m_applying = true;
+    {
+        DrawableActor::UpdateScope scope(m_drawableActor);
+        for (auto const& change : entry.changes)
+            apply(change, false);
+    }
+    m_applying = false;
+    return true;
+}
+
+bool UndoStack::CanUndo() const
+{
+    return m_next > 0;
+}
+
+bool UndoStack::CanRedo() const
+{
+    return m_next < m_entries.size();
+}
+
+void UndoStack::Clear()
+{
+    m_entries.clear();
+    m_next = 0;
+    m_bytes = 0;
+    m_grab = 0;
+}
+
+void UndoStack::SetMemoryCap(size_t bytes)
+{
+    m_memoryCap = bytes;
+    trim();
+}
+
+void UndoStack::SetInsertHandler(InsertHandler handler)
+{
+    m_insert = std::move(handler);
+}
+
+UndoStack::Stats UndoStack::GetStats() const
+{
+    return { int(m_next), int(m_entries.size() - m_next), m_bytes, m_dropped };
+}
+
+size_t UndoStack::bytesOf(Change const& change)
+{
+    auto bytes = sizeof(Change);
+    if (auto insertion = std::get_if<Insertion>(&change))
+        bytes += insertion->shapes.size() * (sizeof(NodeModelRepPtr) + RetainedShapeBytes);
+    else if (auto removal = std::get_if<Removal>(&change))
+        bytes += removal->shapes.size() * (sizeof(NodeModelRepPtr) + RetainedShapeBytes);
+    else if (auto move = std::get_if<Move>(&change))
+        bytes += move->shapes.size() * sizeof(NodeModelRepPtr);
+    else if (auto reshape = std::get_if<Reshape>(&change))
+        bytes += reshape->diffs.size() * sizeof(QVector2D);
+    else if (auto reorder = std::get_if<Reorder>(&change))
+        bytes += reorder->shapes.size() * (sizeof(NodeModelRepPtr) + 2 * sizeof(double));
+    else if (auto edit = std::get_if<TextEdit>(&change))
+        bytes += (edit->before.size() + edit->after.size()) * sizeof(QChar);
+    return bytes;
+}
+
+// the steps of a drag add up to one change
+bool UndoStack::merge(Change& last, Change const& next)
+{
+    auto lastMove = std::get_if<Move>(&last);
+    auto nextMove = std::get_if<Move>(&next);
+    if (lastMove != nullptr && nextMove != nullptr && lastMove->shapes == nextMove->shapes)
+    {
+        lastMove->delta += nextMove->delta;
+        return true;
+    }
+
+    auto lastReshape = std::get_if<Reshape>(&last);
+    auto nextReshape = std::get_if<Reshape>(&next);
+    if (lastReshape != nullptr && nextReshape != nullptr && lastReshape->shape == nextReshape->shape &&
+        lastReshape->diffs.size() == nextReshape->diffs.size())
+    {
+        for (size_t i = 0; i < lastReshape->diffs.size(); ++i)
+            lastReshape->diffs[i] += nextReshape->diffs[i];
+        return true;
+    }
+    return false;
+}
+
+void UndoStack::record(Change change)
+{
+    if (m_applying)
+        return;
+
+    // a new edit drops what could have been redone
+    while (m_entries.size() > m_next)
+    {
+        m_bytes -= m_entries.back().bytes;
+        m_entries.pop_back();
+    }
+
+    if (m_grab != 0 && !m_entries.empty() && m_entries.back().grab == m_grab)
+    {
+        auto& entry = m_entries.back();
+        if (merge(entry.changes.back(), change))
+            return;
+
+        auto bytes = bytesOf(change);
+        entry.changes.push_back(std::move(change));
+        entry.bytes += bytes;
+        m_bytes += bytes;
+    }
+    else
+    {
+        auto bytes = bytesOf(change) + sizeof(Entry);
+        Entry entry{ {}, m_grab, bytes };
+        entry.changes.push_back(std::move(change));
+        m_entries.push_back(std::move(entry));
+        m_bytes += bytes;
+        ++m_next;
+    }
+    trim();
+}
+
+void UndoStack::apply(Change const& change, bool undo)
+{
+    if (auto insertion = std::get_if<Insertion>(&change))
+    {
+        if (undo)
+        {
+            m_drawableActor.Remove(insertion->shapes);
+            return;
+        }
+
+        for (auto const& shape : insertion->shapes)
+            insert(shape);
+    }
+    else if (auto removal = std::get_if<Removal>(&change))
+    {
+        if (!undo)
+        {
+            m_drawableActor.Remove(removal->shapes);
+            return;
+        }
+
+        // the shapes get their z-orders back, if no one took them meanwhile
+        for (auto const& shape : removal->shapes)
+            insert(shape);
+    }
+    else if (auto move = std::get_if<Move>(&change))
+    {
+        auto delta = undo ? -move->delta : move->delta;
+        for (auto const& shape : move->shapes)
+            shape->GetModel()->MoveBy(delta);
+    }
+    else if (auto reshape = std::get_if<Reshape>(&change))
+    {
+        auto model = reshape->shape->GetModel();
+        auto geometry = model->GetGeometry();
+        if (geometry.size() != reshape->diffs.size())
+            return;
+
+        for (size_t i = 0; i < geometry.size(); ++i)
+            geometry[i] += undo ? -reshape->diffs[i] : reshape->diffs[i];
+        model->SetGeometry(geometry);
+    }
+    else if (auto reorder = std::get_if<Reorder>(&change))
+    {
+        auto const& zOrders = undo ? reorder->before : reorder->after;
+        for (size_t i = 0; i < reorder->shapes.size(); ++i)
+            m_drawableActor.Reorder(reorder->shapes[i].get(), zOrders[i]);
+    }
+    else if (auto edit = std::get_if<TextEdit>(&change))
+    {
+        edit->text->SetText(undo ? edit->before : edit->after);
+        m_drawableActor.Repaint(edit->text.get());
+    }
+}
+
+void UndoStack::insert(NodeModelRepPtr const& shape)
+{
+    if (m_insert)
+        m_insert(shape);
+    else
+        m_drawableActor.Insert(shape);
+}
+
+void UndoStack::trim()
+{
+    // the newest entry stays, however large it is
+    while (m_bytes > m_memoryCap && m_next > 1)
+    {
+        m_bytes -= m_entries.front().bytes;
+        m_entries.pop_front();
+        --m_next;
+        ++m_dropped;
+    }
+}
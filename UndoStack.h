@@ -0,0 +1,132 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include <QString>
+#include <QVector2D>
+
+#include "drawables.h"
+
+class DrawableActor;
+
+// History of the edits of a scene, kept as deltas rather than snapshots: moves
+// as one vector for a whole set of shapes, handle edits as the differences of
+// the node positions, z-order changes, added and deleted shapes and text edits.
+// Everything recorded between BeginGrab and EndGrab is one entry, so a drag
+// is undone in one step. The oldest entries are dropped while the history takes
+// more than its memory cap. Undo and Redo go through the DrawableActor with one
+// repaint per entry and are not recorded themselves.
+class UndoStack
+{
+    public:
+    using NodeModelRepPtr = std::shared_ptr<NodeModelRep>;
+    using TextRepPtr = std::shared_ptr<TextRep>;
+
+    static constexpr size_t DefaultMemoryCap = size_t(64) << 20;
+
+    // puts a shape back into the scene on undo or redo, DrawableActor::Insert by default
+    using InsertHandler = std::function<void(NodeModelRepPtr const&)>;
+
+    struct Stats
+    {
+        int undoable = 0;
+        int redoable = 0;
+        size_t bytes = 0;
+        // entries dropped for the memory cap
+        int dropped = 0;
+    };
+
+    UndoStack(DrawableActor& drawableActor, size_t memoryCap = DefaultMemoryCap);
+    void BeginGrab();
+    void EndGrab();
+    void RecordInsert(std::span<NodeModelRepPtr const> shapes);
+    void RecordRemove(std::span<NodeModelRepPtr const> shapes);
+    // shapes moved as a whole, moves of the same shapes within a grab are summed up
+    void RecordMove(std::vector<NodeModelRepPtr> shapes, QVector2D const& delta);
+    // a shape edited through its handles, before is its geometry ahead of the edit
+    void RecordGeometry(NodeModelRepPtr const& shape, std::span<QVector2D const> before);
+    // the shapes have their new z-orders already
+    void RecordZOrders(std::vector<NodeModelRepPtr> shapes, std::vector<double> before);
+    // the text has its new content already
+    void RecordText(TextRepPtr const& text, QString const& before);
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const;
+    bool CanRedo() const;
+    void Clear();
+    void SetMemoryCap(size_t bytes);
+    void SetInsertHandler(InsertHandler handler);
+    Stats GetStats() const;
+
+    private:
+    struct Insertion
+    {
+        std::vector<NodeModelRepPtr> shapes;
+    };
+
+    struct Removal
+    {
+        std::vector<NodeModelRepPtr> shapes;
+    };
+
+    struct Move
+    {
+        std::vector<NodeModelRepPtr> shapes;
+        QVector2D delta;
+    };
+
+    // geometry after the edit minus the one before
+    struct Reshape
+    {
+        NodeModelRepPtr shape;
+        std::vector<QVector2D> diffs;
+    };
+
+    struct Reorder
+    {
+        std::vector<NodeModelRepPtr> shapes;
+        std::vector<double> before;
+        std::vector<double> after;
+    };
+
+    struct TextEdit
+    {
+        TextRepPtr text;
+        QString before;
+        QString after;
+    };
+
+    using Change = std::variant<Insertion, Removal, Move, Reshape, Reorder, TextEdit>;
+
+    struct Entry
+    {
+        std::vector<Change> changes;
+        quint64 grab = 0;
+        size_t bytes = 0;
+    };
+
+    static size_t bytesOf(Change const& change);
+    static bool merge(Change& last, Change const& next);
+    void record(Change change);
+    void apply(Change const& change, bool undo);
+    void insert(NodeModelRepPtr const& shape);
+    void trim();
+
+    DrawableActor& m_drawableActor;
+    InsertHandler m_insert;
+    std::deque<Entry> m_entries;
+    // the entries before it are undone next, the ones from it on redone
+    size_t m_next = 0;
+    size_t m_memoryCap;
+    size_t m_bytes = 0;
+    int m_dropped = 0;
+    // the open grab, 0 if there is none
+    quint64 m_grab = 0;
+    quint64 m_grabs = 0;
+    bool m_applying = false;
+};
@@ -1,4 +1,9 @@
+#include <algorithm>
+
 #include "drawables.h"
+#include "DrawBatch.h"
+#include "HandleRenderer.h"
+#include "ShapeArena.h"
 
 Movable::Movable(const QVector2D& pos) : m_position(pos)
 {
@@ -6,8 +11,15 @@ Movable::Movable(const QVector2D& pos) : m_position(pos)
 
 void Movable::SetExpectedPosition(const QPointF& expPos) const
 {
-    if ((m_position - QVector2D(expPos)).length() < .1)
+    if ((GetPosition() - QVector2D(expPos)).length() < .1)
+        return;
+
+    if (!m_constraints.empty())
+    {
+        for (auto const& [owner, constraint] : m_constraints)
+            constraint(m_startPos.toPoint(), expPos);
         return;
+    }
 
     emit Moved(m_startPos.toPoint(), expPos);
 }
@@ -49,7 +61,8 @@ bool Movable::IsGrabbed() const
 
 void Movable::GrabOn(QPointF const& grabbedPos)
 {
-    m_isGrabbed = m_isSelected = true;
+    setGrabbed(true);
+    SetSelected(true);
 
     auto parent = m_parent.lock();
     if (parent != nullptr)
@@ -60,7 +73,7 @@ void Movable::GrabOn(QPointF const& grabbedPos)
 
 void Movable::Released()
 {
-    m_isGrabbed = false;
+    setGrabbed(false);
 }
 
 double Movable::GetZOrder()
@@ -92,6 +105,93 @@ void Movable::SetParent(MovablePtr parent)
 {
     m_parent = parent;
 }
+
+QRectF Movable::Bounds() const
+{
+    return QRectF(GetPosition().toPointF(), QSizeF());
+}
+
+void Movable::setGrabbed(bool grabbed)
+{
+    m_isGrabbed = grabbed;
+}
+
+void Movable::SetConstraint(Movable const* owner, Constraint constraint)
+{
+    auto found = std::find_if(m_constraints.begin(), m_constraints.end(),
+        [owner](auto const& entry) { return entry.first == owner; });
+    if (found != m_constraints.end())
+        found->second = std::move(constraint);
+    else
+        m_constraints.emplace_back(owner, std::move(constraint));
+}
+
+void Movable::ClearConstraint(Movable const* owner)
+{
+    std::erase_if(m_constraints, [owner](auto const& entry) { return entry.first == owner; });
+}
+
+//----------------------------------------------------------------
+//----------------------------------------------------------------
+
+Node::Node(const QVector2D& pos) : Movable{ pos }, m_index(NodeStore::Shared().Allocate(pos))
+{
+}
+
+Node::Node(const QPointF& pos) : Node{ QVector2D(pos) }
+{
+}
+
+Node::~Node()
+{
+    NodeStore::Shared().Release(m_index);
+}
+
+NodeStore::Index Node::Index() const
+{
+    return m_index;
+}
+
+void Node::SetPosition(const QVector2D& pos)
+{
+    NodeStore::Shared().SetPosition(m_index, pos);
+}
+
+QVector2D Node::GetPosition() const
+{
+    return NodeStore::Shared().Position(m_index);
+}
+
+double Node::GetZOrder()
+{
+    return NodeStore::Shared().ZOrder(m_index);
+}
+
+void Node::SetZOrder(double zOrder)
+{
+    NodeStore::Shared().SetZOrder(m_index, zOrder);
+}
+
+bool Node::IsSelected()
+{
+    return NodeStore::Shared().HasFlag(m_index, NodeStore::Selected);
+}
+
+void Node::SetSelected(bool selected)
+{
+    NodeStore::Shared().SetFlag(m_index, NodeStore::Selected, selected);
+}
+
+bool Node::IsGrabbed() const
+{
+    return NodeStore::Shared().HasFlag(m_index, NodeStore::Grabbed);
+}
+
+void Node::setGrabbed(bool grabbed)
+{
+    NodeStore::Shared().SetFlag(m_index, NodeStore::Grabbed, grabbed);
+}
+
 //----------------------------------------------------------------
 //----------------------------------------------------------------
 
@@ -99,11 +199,91 @@ NodeModel::NodeModel(QVector2D const& pos) : Movable{ pos }
 {
 }
 
+NodeModel::~NodeModel()
+{
+    // the nodes can outlive the model, their constraints point to it
+    for (auto const& node : m_nodes)
+        node->ClearConstraint(this);
+}
+
+void NodeModel::AddChangeListener(void const* owner, ChangeListener listener)
+{
+    m_changeListeners.emplace_back(owner, std::move(listener));
+}
+
+void NodeModel::RemoveChangeListener(void const* owner)
+{
+    std::erase_if(m_changeListeners, [owner](auto const& listener) { return listener.first == owner; });
+}
+
+void NodeModel::AddSelectionListener(void const* owner, SelectionListener listener)
+{
+    m_selectionListeners.emplace_back(owner, std::move(listener));
+}
+
+void NodeModel::RemoveSelectionListener(void const* owner)
+{
+    std::erase_if(m_selectionListeners, [owner](auto const& listener) { return listener.first == owner; });
+}
+
+void NodeModel::SetSelected(bool selected)
+{
+    if (selected == IsSelected())
+        return;
+
+    Movable::SetSelected(selected);
+    for (auto const& [owner, listener] : m_selectionListeners)
+        listener(selected);
+}
+
+void NodeModel::MoveBy(const QVector2D& delta)
+{
+    SetPosition(GetPosition() + delta);
+    NodeStore::Shared().Translate(m_nodeIndices, delta);
+    NotifyChanged();
+}
+
+std::vector<QVector2D> NodeModel::GetGeometry() const
+{
+    std::vector<QVector2D> geometry{ GetPosition() };
+    geometry.reserve(m_nodeIndices.size() + 1);
+    for (auto index : m_nodeIndices)
+        geometry.push_back(NodeStore::Shared().Position(index));
+    return geometry;
+}
+
+void NodeModel::SetGeometry(std::span<QVector2D const> geometry)
+{
+    if (geometry.size() != m_nodeIndices.size() + 1)
+        return;
+
+    SetPosition(geometry[0]);
+    for (size_t i = 0; i < m_nodeIndices.size(); ++i)
+        NodeStore::Shared().SetPosition(m_nodeIndices[i], geometry[i + 1]);
+    NotifyChanged();
+}
+
+void NodeModel::addNode(std::shared_ptr<Node> const& node)
+{
+    if (m_nodes.contains(node))
+        return;
+
+    m_nodes.insert(node);
+    m_nodeIndices.push_back(node->Index());
+}
+
+void NodeModel::NotifyChanged()
+{
+    for (auto const& [owner, listener] : m_changeListeners)
+        listener();
+
+    emit Changed();
+}
+
 void NodeModel::SetZOrder(double zOrder)
 {
     Movable::SetZOrder(zOrder);
-    for (auto node : m_nodes)
-        node->SetZOrder(zOrder + .1);
+    NodeStore::Shared().SetZOrder(m_nodeIndices, zOrder + .1);
 }
 
 void NodeModel::SetParentToNodes(std::shared_ptr<Movable> parent)
@@ -112,38 +292,46 @@ void NodeModel::SetParentToNodes(std::shared_ptr<Movable> parent)
         node->SetParent(parent);
 }
 
+QRectF NodeModel::Bounds() const
+{
+    if (m_nodeIndices.empty())
+        return Movable::Bounds();
+
+    // the shapes are spanned by their nodes, the margin covers the handles
+    return NodeStore::Shared().Bounds(m_nodeIndices, 10.f);
+}
+
+QRectF NodeModel::ShapeBounds() const
+{
+    if (m_nodeIndices.empty())
+        return Movable::Bounds();
+
+    return NodeStore::Shared().Bounds(m_nodeIndices);
+}
+
 //----------------------------------------------------------------
 //----------------------------------------------------------------
 
 IntNode::IntNode(const std::shared_ptr<Node>& node) :
     NodeModel{ node->GetPosition() }, m_node(node)
 {
-    m_nodes.insert(m_node);
+    addNode(m_node);
 }
 
 void IntNode::Free()
 {
-    connect(m_node.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos) // if it is grabbed as a Node
+    auto move = [this](const QPointF& fromPos, const QPointF& toPos)
         {
             SetPosition(toPos - fromPos + GetPosition().toPointF());
             SetStartPos(toPos);
             m_node->SetPosition(GetPosition());
             m_node->SetStartPos(toPos);
 
-            emit Changed();
-        });
+            NotifyChanged();
+        };
 
-    connect(this, &NodeModel::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos) // if it is grabbed as a NodeModel
-        {
-            SetPosition(toPos - fromPos + GetPosition().toPointF());
-            SetStartPos(toPos);
-            m_node->SetPosition(GetPosition());
-            m_node->SetStartPos(toPos);
-
-            emit Changed();
-        });
+    m_node->SetConstraint(this, move); // if it is grabbed as a Node
+    SetConstraint(this, move); // if it is grabbed as a NodeModel
 }
 
 bool IntNode::IsPointOn(const QPointF& pos) const
@@ -151,6 +339,12 @@ bool IntNode::IsPointOn(const QPointF& pos) const
     return m_node->IsPointOn(pos);
 }
 
+QRectF IntNode::ShapeBounds() const
+{
+    // a free node is drawn as its handle
+    return m_node->Bounds();
+}
+
 //----------------------------------------------------------------
 //----------------------------------------------------------------
 
@@ -158,9 +352,9 @@ IntNodeRep::IntNodeRep(const SingleNodePtr& singleNode) : m_singleNode(singleNod
 {
 }
 
-void IntNodeRep::Draw(QPainter* painter) const
+void IntNodeRep::DrawShape(QPainter* painter) const
 {
-    painter->drawEllipse(m_singleNode->m_node->GetPosition().toPointF(), 10, 10);
+    HandleRenderer::DrawHandle(painter, m_singleNode->m_node->GetPosition().toPointF());
     //auto topLeft = m_singleNode->m_node->GetPosition() - QPointF(5, 5);
     //painter->drawRect(QRectF(topLeft, QSizeF(10., 10.)));
 }
@@ -176,22 +370,20 @@ std::shared_ptr<NodeModel> IntNodeRep::GetModel() const
 IntVector::IntVector(const NodePtr& nodeA, const NodePtr& nodeB) :
     m_nodeA(nodeA), m_nodeB(nodeB), NodeModel{ QVector2D{} }
 {
-    m_nodes.insert(nodeA);
-    m_nodes.insert(nodeB);
+    addNode(nodeA);
+    addNode(nodeB);
     SetPosition((nodeA->GetPosition() + nodeB->GetPosition()) / 2);
 
-    connect(this, &NodeModel::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             SetPosition(toPos - fromPos + GetPosition().toPointF());
             SetStartPos(toPos);
 
-            nodeA->SetPosition(toPos - fromPos + nodeA->GetPosition().toPointF());
-            nodeA->SetStartPos(toPos);
-
-            nodeB->SetPosition(toPos - fromPos + nodeB->GetPosition().toPointF());
-            nodeB->SetStartPos(toPos);
-            emit Changed();
+            NodeStore::Shared().Translate(m_nodeIndices, QVector2D(toPos - fromPos));
+            m_nodeA->SetStartPos(toPos);
+            m_nodeB->SetStartPos(toPos);
+            NotifyChanged();
         });
 }
 
@@ -208,57 +400,57 @@ void IntVector::FixOnDirection()
 {
     auto lineVec = QVector2D(m_nodeB->GetPosition() - m_nodeA->GetPosition()).normalized();
 
-    auto connectMovements = [=](NodePtr baseNode, NodePtr movingNode)
+    auto connectMovements = [=, this](Node* baseNode, Node* movingNode)
     {
-        connect(movingNode.get(), &Node::Moved, this,
-            [=](const QPointF& fromPos, const QPointF& toPos)
+        movingNode->SetConstraint(this,
+            [=, this](const QPointF& fromPos, const QPointF& toPos)
             {
                 auto newPointVec = QVector2D(toPos) - baseNode->GetPosition();
                 auto proj = QVector2D::dotProduct(lineVec, newPointVec) * lineVec;
                 movingNode->SetPosition(proj + baseNode->GetPosition());
-                emit Changed();
+                NotifyChanged();
             });
     };
 
-    connectMovements(m_nodeA, m_nodeB);
-    connectMovements(m_nodeB, m_nodeA);
+    connectMovements(m_nodeA.get(), m_nodeB.get());
+    connectMovements(m_nodeB.get(), m_nodeA.get());
 }
 
 void IntVector::ParallelToDirection()
 {
     auto lineVec = QVector2D(m_nodeB->GetPosition() - m_nodeA->GetPosition()).normalized();
-    auto connectMovements = [=](NodePtr baseNode, NodePtr movingNode)
+    auto connectMovements = [=, this](Node* baseNode, Node* movingNode)
     {
-        connect(movingNode.get(), &Node::Moved, this,
-            [=](const QPointF& fromPos, const QPointF& toPos)
+        movingNode->SetConstraint(this,
+            [=, this](const QPointF& fromPos, const QPointF& toPos)
             {
                 auto newPointVec = QVector2D(toPos) - baseNode->GetPosition();
                 auto projVec = QVector2D::dotProduct(lineVec, newPointVec) * lineVec;
 
                 baseNode->SetPosition((newPointVec - projVec) + baseNode->GetPosition());
                 movingNode->SetPosition(toPos);
-                emit Changed();
+                NotifyChanged();
             });
     };
 
-    connectMovements(m_nodeA, m_nodeB);
-    connectMovements(m_nodeB, m_nodeA);
+    connectMovements(m_nodeA.get(), m_nodeB.get());
+    connectMovements(m_nodeB.get(), m_nodeA.get());
 }
 
 void IntVector::FreeVector()
 {
-    connect(m_nodeA.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeA->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             m_nodeA->SetPosition(toPos);
-            emit Changed();
+            NotifyChanged();
         });
 
-    connect(m_nodeB.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeB->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             m_nodeB->SetPosition(toPos);
-            emit Changed();
+            NotifyChanged();
         });
 }
 
@@ -274,20 +466,24 @@ double IntVector::Length() const
 
 VectorRep::VectorRep(const VecPtr& vector) : m_vector(vector)
 {
-    m_nodeARep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(vector->m_nodeA));
-    m_nodeBRep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(vector->m_nodeB));
 }
 
-void VectorRep::Draw(QPainter* painter) const
+void VectorRep::DrawShape(QPainter* painter) const
 {
     painter->drawLine(m_vector->m_nodeA->GetPosition().toPointF(),
         m_vector->m_nodeB->GetPosition().toPointF());
+}
 
-    if (!m_vector->IsSelected())
-        return;
+void VectorRep::DrawHandles(QPainter* painter) const
+{
+    HandleRenderer::DrawHandles(painter, *m_vector);
+}
 
-    m_nodeARep->Draw(painter);
-    m_nodeBRep->Draw(painter);
+bool VectorRep::AddTo(DrawBatch& batch) const
+{
+    batch.AddLine(QLineF(m_vector->m_nodeA->GetPosition().toPointF(),
+        m_vector->m_nodeB->GetPosition().toPointF()));
+    return true;
 }
 
 std::shared_ptr<NodeModel> VectorRep::GetModel() const
@@ -304,26 +500,26 @@ IntPath::IntPath() : NodeModel{ QVector2D(0, 0) } //TODO
 
 void IntPath::AddPoint(const QPointF& newPoint)
 {
-    AddNode(std::make_shared<Node>(newPoint));
+    AddNode(ShapeArena::Make<Node>(newPoint));
 }
 
 void IntPath::AddNode(const NodePtr& newNode)
 {
-    m_nodes.insert(newNode);
+    addNode(newNode);
     if (prevAddedNode == nullptr)
     {
         prevAddedNode = newNode;
         firstNode = newNode;
         return;
     }
-    auto newVec = std::make_shared<IntVector>(prevAddedNode, newNode);
+    auto newVec = ShapeArena::Make<IntVector>(prevAddedNode, newNode);
     m_vectors.append(newVec);
     prevAddedNode = newNode;
 }
 
 void IntPath::Close()
 {
-    m_vectors.append(std::make_shared<IntVector>(prevAddedNode, firstNode));
+    m_vectors.append(ShapeArena::Make<IntVector>(prevAddedNode, firstNode));
 }
 
 bool IntPath::IsPointOn(const QPointF& pos) const
@@ -337,7 +533,7 @@ bool IntPath::IsPointOn(const QPointF& pos) const
 PathRep::PathRep(const PathPtr& path) : m_path(path)
 {
     for (auto vec : path->m_vectors)
-        m_vecReps.append(std::make_shared<VectorRep>(vec));
+        m_vecReps.append(ShapeArena::Make<VectorRep>(vec));
 }
 
 void PathRep::Draw(QPainter* painter) const
@@ -346,6 +542,12 @@ void PathRep::Draw(QPainter* painter) const
         vecRep->Draw(painter);
 }
 
+void PathRep::DrawShape(QPainter* painter) const
+{
+    for (auto vecRep : m_vecReps)
+        vecRep->DrawShape(painter);
+}
+
 std::shared_ptr<NodeModel> PathRep::GetModel() const
 {
     return m_path;
@@ -354,40 +556,42 @@ std::shared_ptr<NodeModel> PathRep::GetModel() const
 //----------------------------------------------------------------
 //----------------------------------------------------------------
 
-IntRect::IntRect(QRectF initialRect) : NodeModel{ QVector2D{} }
+IntRect::IntRect(QRectF initialRect) : IntRect{ QVector2D(initialRect.center()),
+    QVector2D(initialRect.topLeft() - initialRect.center()),
+    QVector2D(initialRect.topRight() - initialRect.center()) }
 {
-    m_nodeA = std::make_shared<Node>(initialRect.topLeft());
-    m_nodeB = std::make_shared<Node>(initialRect.topRight());
-    m_nodeC = std::make_shared<Node>(initialRect.bottomRight());
-    m_nodeD = std::make_shared<Node>(initialRect.bottomLeft());
-
-    m_diaVecA = QVector2D(initialRect.topLeft() - initialRect.center());
-    m_diaVecB = QVector2D(initialRect.topRight() - initialRect.center());
+}
 
-    SetPosition(initialRect.center());
+IntRect::IntRect(QVector2D const& centre, QVector2D const& diaVecA, QVector2D const& diaVecB) :
+    NodeModel{ centre }, m_diaVecA(diaVecA), m_diaVecB(diaVecB)
+{
+    m_nodeA = ShapeArena::Make<Node>(centre + m_diaVecA);
+    m_nodeB = ShapeArena::Make<Node>(centre + m_diaVecB);
+    m_nodeC = ShapeArena::Make<Node>(centre - m_diaVecA);
+    m_nodeD = ShapeArena::Make<Node>(centre - m_diaVecB);
 
-    m_nodeR = std::make_shared<Node>(
+    m_nodeR = ShapeArena::Make<Node>(
         (GetPosition() + m_diaVecA + 20.0 * m_diaVecA.normalized()).toPointF());
 
-    m_nodeM = std::make_shared<Node>(GetPosition());
+    m_nodeM = ShapeArena::Make<Node>(GetPosition());
 
-    m_nodes.insert(m_nodeA);
-    m_nodes.insert(m_nodeB);
-    m_nodes.insert(m_nodeC);
-    m_nodes.insert(m_nodeD);
-    m_nodes.insert(m_nodeR);
-    m_nodes.insert(m_nodeM);
+    addNode(m_nodeA);
+    addNode(m_nodeB);
+    addNode(m_nodeC);
+    addNode(m_nodeD);
+    addNode(m_nodeR);
+    addNode(m_nodeM);
 
-    connect(this, &NodeModel::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             SetPosition(toPos - fromPos + GetPosition().toPointF());
             SetStartPos(toPos);
             UpdateNodes();
         });
 
-    connect(m_nodeA.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeA->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             if ((GetPosition() - QVector2D(toPos)).length() < 5.0)
                 return;
@@ -407,8 +611,8 @@ IntRect::IntRect(QRectF initialRect) : NodeModel{ QVector2D{} }
         });
 
 
-    connect(m_nodeB.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeB->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             if ((GetPosition() - QVector2D(toPos)).length() < 5.0)
                 return;
@@ -428,8 +632,8 @@ IntRect::IntRect(QRectF initialRect) : NodeModel{ QVector2D{} }
         });
 
     //TODO: Refactor and optimize move handlers
-    connect(m_nodeC.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeC->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             if ((GetPosition() - QVector2D(toPos)).length() < 5.0)
                 return;
@@ -448,8 +652,8 @@ IntRect::IntRect(QRectF initialRect) : NodeModel{ QVector2D{} }
             UpdateNodes();
         });
 
-    connect(m_nodeD.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeD->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             if ((GetPosition() - QVector2D(toPos)).length() < 5.0)
                 return;
@@ -468,8 +672,8 @@ IntRect::IntRect(QRectF initialRect) : NodeModel{ QVector2D{} }
             UpdateNodes();
         });
 
-    connect(m_nodeR.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeR->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
 
             auto devD = (QVector2D(toPos) - GetPosition()).normalized();
@@ -479,8 +683,8 @@ IntRect::IntRect(QRectF initialRect) : NodeModel{ QVector2D{} }
             RotateBy(-angle);
         });
 
-    connect(m_nodeM.get(), &Node::Moved, this,
-        [=](const QPointF& fromPos, const QPointF& toPos)
+    m_nodeM->SetConstraint(this,
+        [this](const QPointF& fromPos, const QPointF& toPos)
         {
             SetPosition(toPos);
             UpdateNodes();
@@ -497,6 +701,33 @@ bool IntRect::IsPointOn(const QPointF& pos) const
         abs(QVector2D::dotProduct(pVec, midX)) < Width() / 2.f;
 }
 
+QRectF IntRect::ShapeBounds() const
+{
+    // the corners are the first four nodes
+    return NodeStore::Shared().Bounds(std::span(m_nodeIndices).first(4));
+}
+
+QVector2D IntRect::DiagonalA() const
+{
+    return m_diaVecA;
+}
+
+QVector2D IntRect::DiagonalB() const
+{
+    return m_diaVecB;
+}
+
+void IntRect::SetGeometry(std::span<QVector2D const> geometry)
+{
+    // corners A and B follow the centre
+    if (geometry.size() == m_nodeIndices.size() + 1)
+    {
+        m_diaVecA = geometry[1] - geometry[0];
+        m_diaVecB = geometry[2] - geometry[0];
+    }
+    NodeModel::SetGeometry(geometry);
+}
+
 float IntRect::AngleZ() const
 {
     auto midXN = ((m_diaVecB - m_diaVecA) / 2.).normalized();
@@ -523,7 +754,7 @@ void IntRect::UpdateNodes()
     m_nodeD->SetPosition(centre - m_diaVecB);
     m_nodeR->SetPosition(centre + m_diaVecA + 20.0 * m_diaVecA.normalized());
     m_nodeM->SetPosition(centre);
-    emit Changed();
+    NotifyChanged();
 }
 
 void IntRect::RotateBy(double angle)
@@ -540,15 +771,9 @@ void IntRect::RotateBy(double angle)
 
 RectRep::RectRep(RectPtr const& rect) : m_rect(rect)
 {
-    m_nodeRRep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(rect->m_nodeR));
-    m_nodeMRep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(rect->m_nodeM));
-    m_nodeARep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(rect->m_nodeA));
-    m_nodeBRep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(rect->m_nodeB));
-    m_nodeCRep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(rect->m_nodeC));
-    m_nodeDRep = std::make_shared<IntNodeRep>(std::make_shared<IntNode>(rect->m_nodeD));
 }
 
-void RectRep::Draw(QPainter* painter) const
+void RectRep::DrawShape(QPainter* painter) const
 {
     painter->save();
     painter->translate(m_rect->GetPosition().toPointF());
@@ -557,19 +782,21 @@ void RectRep::Draw(QPainter* painter) const
         QRectF(-QPointF(m_rect->Width() / 2., m_rect->Height() / 2.),
         QPointF(m_rect->Width() / 2., m_rect->Height() / 2.)));
     painter->restore();
+}
 
-    if (!m_rect->IsSelected())
-        return;
+void RectRep::DrawHandles(QPainter* painter) const
+{
+    HandleRenderer::DrawRectHandles(painter, *m_rect, false);
+}
 
-    painter->save();
-    painter->setBrush(Qt::BrushStyle::NoBrush);
-    m_nodeRRep->Draw(painter);
-    m_nodeMRep->Draw(painter);
-    m_nodeARep->Draw(painter);
-    m_nodeBRep->Draw(painter);
-    m_nodeCRep->Draw(painter);
-    m_nodeDRep->Draw(painter);
-    painter->restore();
+bool RectRep::AddTo(DrawBatch& batch) const
+{
+    // the corner nodes are the rotated rect
+    batch.AddPolygon(QPolygonF({ m_rect->m_nodeA->GetPosition().toPointF(),
+        m_rect->m_nodeB->GetPosition().toPointF(),
+        m_rect->m_nodeC->GetPosition().toPointF(),
+        m_rect->m_nodeD->GetPosition().toPointF() }));
+    return true;
 }
 
 std::shared_ptr<NodeModel> RectRep::GetModel() const
@@ -582,25 +809,29 @@ std::shared_ptr<NodeModel> RectRep::GetModel() const
 
 
 EllipseRep::EllipseRep(RectPtr const& rect) :
-    m_rect(rect), m_rectRep(std::make_shared<RectRep>(rect))
+    m_rect(rect)
 {
 }
 
-void EllipseRep::Draw(QPainter* painter) const
+void EllipseRep::DrawShape(QPainter* painter) const
 {
     painter->save();
     painter->translate(m_rect->GetPosition().toPointF());
     painter->rotate(m_rect->AngleZ());
     painter->drawEllipse(QPointF(0., 0.), m_rect->Width() / 2., m_rect->Height() / 2.);
     painter->restore();
+}
 
-    if (!m_rect->IsSelected())
-        return;
+void EllipseRep::DrawHandles(QPainter* painter) const
+{
+    HandleRenderer::DrawRectHandles(painter, *m_rect, true);
+}
 
-    painter->save();
-    painter->setBrush(Qt::BrushStyle::NoBrush);
-    m_rectRep->Draw(painter);
-    painter->restore();
+bool EllipseRep::AddTo(DrawBatch& batch) const
+{
+    batch.AddEllipse(m_rect->GetPosition().toPointF(),
+        m_rect->Width() / 2., m_rect->Height() / 2., m_rect->AngleZ());
+    return true;
 }
 
 std::shared_ptr<NodeModel> EllipseRep::GetModel() const
@@ -613,28 +844,65 @@ std::shared_ptr<NodeModel> EllipseRep::GetModel() const
 
 TextRep::TextRep(QString text, TextRep::RectPtr rect): 
     m_text(text),
-    m_rect(rect),
-    m_rectRep(std::make_shared<RectRep>(rect))
+    m_rect(rect)
 {
 }
 
-void TextRep::Draw(QPainter* painter) const
+void TextRep::DrawShape(QPainter* painter) const
 {
     painter->save();
     painter->translate(m_rect->m_nodeA->GetPosition().toPointF());
     painter->rotate(m_rect->AngleZ());
-    painter->drawText(QRect(0,0, m_rect->Width(), m_rect->Height()), m_text);
+    // the lines are not wrapped, the text is cut at the box
+    painter->setClipRect(QRectF(0., 0., m_rect->Width(), m_rect->Height()), Qt::IntersectClip);
+    {
+        std::lock_guard<std::mutex> lock(m_layoutMutex);
+        if (!m_layoutValid || m_layoutFont != painter->font())
+        {
+            m_layout = QStaticText(m_text);
+            m_layout.setTextFormat(Qt::PlainText);
+            m_layoutFont = painter->font();
+            m_layoutValid = true;
+        }
+        painter->drawStaticText(QPointF(0., 0.), m_layout);
+    }
     painter->restore();
+}
 
-    if (!m_rect->IsSelected())
-        return;
+void TextRep::DrawHandles(QPainter* painter) const
+{
+    HandleRenderer::DrawRectHandles(painter, *m_rect, true);
+}
+
+void TextRep::DrawGreeked(QPainter* painter) const
+{
+    // one grey bar per line, as long as the line would be with an average glyph width
+    auto metrics = painter->fontMetrics();
+    auto lineHeight = double(metrics.height());
+    auto maxWidth = double(m_rect->Width());
 
     painter->save();
-    painter->setBrush(Qt::BrushStyle::NoBrush);
-    m_rectRep->Draw(painter);
+    painter->translate(m_rect->m_nodeA->GetPosition().toPointF());
+    painter->rotate(m_rect->AngleZ());
+
+    auto top = 0.;
+    for (auto const& line : m_text.split('\n'))
+    {
+        if (top + lineHeight > m_rect->Height())
+            break;
+
+        auto width = std::min(maxWidth, line.size() * double(metrics.averageCharWidth()));
+        painter->fillRect(QRectF(0., top + lineHeight * .2, width, lineHeight * .6), Qt::lightGray);
+        top += lineHeight;
+    }
     painter->restore();
 }
 
+bool TextRep::HasText() const
+{
+    return true;
+}
+
 std::shared_ptr<NodeModel> TextRep::GetModel() const
 {
     return m_rect;
@@ -647,5 +915,11 @@ QString TextRep::GetText() const
 
 void TextRep::SetText(QString const& text)
 {
-    m_text = text;
+    {
+        std::lock_guard<std::mutex> lock(m_layoutMutex);
+        m_text = text;
+        m_layoutValid = false;
+    }
+    // the paged chunk of the text gets written back with the new one
+    m_rect->NotifyChanged();
 }
\ No newline at end of file
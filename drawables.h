@@ -1,5 +1,11 @@
 #pragma once
 
+#include <functional>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
 #include <QBrush>
 #include <QPen>
 #include <QPixmap>
@@ -8,16 +14,24 @@
 #include <QVector3D>
 #include <QDebug>
 #include <QPainter>
+#include <QStaticText>
 #include <QGenericMatrix>
 #include <QTransform>
 #include <QMatrix4x4>
 
+#include "NodeStore.h"
+
+class DrawBatch;
+
 class Movable : public QObject
 {
     Q_OBJECT
     public:
 
     using MovablePtr = std::weak_ptr<Movable>;
+    // called directly instead of emitting Moved, every model sharing the movable sets
+    // its own constraint and a new one of the same model replaces the previous
+    using Constraint = std::function<void(const QPointF& fromPos, const QPointF& toPos)>;
     Movable(const QVector2D& pos);
     virtual void SetExpectedPosition(const QPointF& pos) const;
     virtual void SetPosition(const QVector2D& pos);
@@ -36,11 +50,18 @@ class Movable : public QObject
     virtual MovablePtr Parent();
     virtual void SetParent(MovablePtr parent);
     virtual bool IsPointOn(const QPointF& pos) const = 0;
+    virtual QRectF Bounds() const;
+    void SetConstraint(Movable const* owner, Constraint constraint);
+    void ClearConstraint(Movable const* owner);
 
     signals:
     void Moved(const QPointF fromPos, const QPointF toPos) const;
 
+    protected:
+    virtual void setGrabbed(bool grabbed);
+
     private:
+    std::vector<std::pair<Movable const*, Constraint>> m_constraints;
     QVector2D m_position;
     QVector2D m_startPos;
     double m_zOrder = 0.0;
@@ -54,18 +75,36 @@ class Node : public Movable
     Q_OBJECT
     public:
 
-    Node(const QVector2D& pos) : Movable{pos}
-    {
-    }
+    Node(const QVector2D& pos);
+    Node(const QPointF& pos);
+    ~Node();
+
+    // the position, z-order and flags of a node live in the NodeStore
+    NodeStore::Index Index() const;
+    using Movable::SetPosition;
+    void SetPosition(const QVector2D& pos) override;
+    QVector2D GetPosition() const override;
+    double GetZOrder() override;
+    void SetZOrder(double zOrder) override;
+    bool IsSelected() override;
+    void SetSelected(bool selected) override;
+    bool IsGrabbed() const override;
 
-    Node(const QPointF& pos) : Movable{ QVector2D(pos) }
+    virtual bool IsPointOn(const QPointF& pos) const
     {
+        return (GetPosition() - QVector2D(pos)).length() < 10;
     }
 
-    virtual bool IsPointOn(const QPointF& pos) const
+    virtual QRectF Bounds() const
     {
-        return (GetPosition() - QVector2D(pos)).length() < 10;
+        return QRectF(GetPosition().toPointF() - QPointF(10, 10), QSizeF(20, 20));
     }
+
+    protected:
+    void setGrabbed(bool grabbed) override;
+
+    private:
+    NodeStore::Index m_index;
 };
 
 class NodeModel : public Movable
@@ -75,21 +114,63 @@ class NodeModel : public Movable
     NodeModel(const QVector2D& pos);
     virtual void SetZOrder(double zOrder);
     virtual void SetParentToNodes(std::shared_ptr<Movable> parent);
-    virtual ~NodeModel() = default;
+    virtual QRectF Bounds() const;
+    // area of the shape itself, without the handles around its nodes
+    virtual QRectF ShapeBounds() const;
+    void SetSelected(bool selected) override;
+    // moves the shape with all its nodes, as a drag of the whole model would
+    virtual void MoveBy(const QVector2D& delta);
+    // the position of the model followed by the positions of its nodes in the order they were added
+    std::vector<QVector2D> GetGeometry() const;
+    virtual void SetGeometry(std::span<QVector2D const> geometry);
+    virtual ~NodeModel();
+    // called directly on every change, owner identifies the listener to remove it again
+    using ChangeListener = std::function<void()>;
+    void AddChangeListener(void const* owner, ChangeListener listener);
+    void RemoveChangeListener(void const* owner);
+    // calls the change listeners, also for changes outside the nodes like the text of a TextRep
+    void NotifyChanged();
+    // called when the model gets selected or unselected
+    using SelectionListener = std::function<void(bool selected)>;
+    void AddSelectionListener(void const* owner, SelectionListener listener);
+    void RemoveSelectionListener(void const* owner);
     QSet<std::shared_ptr<Node>> m_nodes;
+    // store indices of m_nodes in the order they were added
+    std::vector<NodeStore::Index> m_nodeIndices;
 
     signals:
     void Changed();
+
+    protected:
+    void addNode(std::shared_ptr<Node> const& node);
+
+    private:
+    std::vector<std::pair<void const*, ChangeListener>> m_changeListeners;
+    std::vector<std::pair<void const*, SelectionListener>> m_selectionListeners;
 };
 
 class NodeModelRep
 {
     public:
-    virtual void Draw(QPainter* painter) const = 0;
+    // the shape and, when it is selected, its handles
+    virtual void Draw(QPainter* painter) const
+    {
+        DrawShape(painter);
+        if (GetModel()->IsSelected())
+            DrawHandles(painter);
+    }
+    virtual void DrawShape(QPainter* painter) const = 0;
+    virtual void DrawHandles(QPainter* painter) const {}
+    // stand-in for a text too small to read
+    virtual void DrawGreeked(QPainter* painter) const { DrawShape(painter); }
     virtual std::shared_ptr<NodeModel> GetModel() const = 0;
+    // world space area covered by Draw, used for culling
+    virtual QRectF Bounds() const { return GetModel()->Bounds(); }
+    // hands the shape to a batch instead of drawing it, false if DrawShape has to be used
+    virtual bool AddTo(DrawBatch& batch) const { return false; }
     //virtual void SetText(QString const& text) = 0;
     //virtual QString GetText() const = 0;
-    //virtual bool HasText() const = 0;
+    virtual bool HasText() const { return false; }
     virtual ~NodeModelRep() = default;
 };
 
@@ -101,6 +182,7 @@ class IntNode : public NodeModel
     IntNode(const std::shared_ptr<Node>& node);
     void Free();
     virtual bool IsPointOn(const QPointF& pos) const;
+    virtual QRectF ShapeBounds() const;
     std::shared_ptr<Node> m_node;
 };
 
@@ -109,7 +191,7 @@ class IntNodeRep : public NodeModelRep
     public:
     using SingleNodePtr = std::shared_ptr<IntNode>;
     IntNodeRep(const SingleNodePtr& singleNode);
-    void Draw(QPainter* painter) const override;
+    void DrawShape(QPainter* painter) const override;
 
     std::shared_ptr<NodeModel> GetModel() const override;
     private:
@@ -143,17 +225,16 @@ class VectorRep : public NodeModelRep
 {
     public:
     using VecPtr = std::shared_ptr<IntVector>;
-    using NodeRepPtr = std::shared_ptr<IntNodeRep>;
     VectorRep(const VecPtr& vector);
 
-    virtual void Draw(QPainter* painter) const override;
+    virtual void DrawShape(QPainter* painter) const override;
+    virtual void DrawHandles(QPainter* painter) const override;
+    bool AddTo(DrawBatch& batch) const override;
 
     std::shared_ptr<NodeModel> GetModel() const override;
 
     private:
     VecPtr m_vector;
-    NodeRepPtr m_nodeARep;
-    NodeRepPtr m_nodeBRep;
 };
 
 class IntPath : public NodeModel
@@ -183,6 +264,7 @@ class PathRep : public NodeModelRep
 
     PathRep(const PathPtr& path);
     virtual void Draw(QPainter* painter) const override;
+    virtual void DrawShape(QPainter* painter) const override;
     std::shared_ptr<NodeModel> GetModel() const override;
 
     private:
@@ -197,7 +279,13 @@ class IntRect : public NodeModel
     public:
 
     IntRect(QRectF initialRect);
+    // corner A is centre + diaVecA, B is centre + diaVecB, C and D are opposite to them
+    IntRect(QVector2D const& centre, QVector2D const& diaVecA, QVector2D const& diaVecB);
     virtual bool IsPointOn(const QPointF& pos) const;
+    virtual QRectF ShapeBounds() const;
+    QVector2D DiagonalA() const;
+    QVector2D DiagonalB() const;
+    void SetGeometry(std::span<QVector2D const> geometry) override;
     float AngleZ() const;
     float Height() const;
     float Width() const;
@@ -221,20 +309,15 @@ class IntRect : public NodeModel
 class RectRep : public NodeModelRep
 {
     public:
-    using NodeRepPtr = std::shared_ptr<IntNodeRep>;
     using PathRepPtr = std::shared_ptr<PathRep>;
     using RectPtr = std::shared_ptr<IntRect>;
 
     RectRep(RectPtr const& rect);
-    virtual void Draw(QPainter* painter) const override;
+    virtual void DrawShape(QPainter* painter) const override;
+    virtual void DrawHandles(QPainter* painter) const override;
+    bool AddTo(DrawBatch& batch) const override;
     std::shared_ptr<NodeModel> GetModel() const override;
 
-    NodeRepPtr m_nodeRRep;
-    NodeRepPtr m_nodeMRep;
-    NodeRepPtr m_nodeARep;
-    NodeRepPtr m_nodeBRep;
-    NodeRepPtr m_nodeCRep;
-    NodeRepPtr m_nodeDRep;
     RectPtr m_rect;
 };
 
@@ -242,31 +325,38 @@ class TextRep : public NodeModelRep
 {
     public:
     using RectPtr = std::shared_ptr<IntRect>;
-    using RectRepPtr = std::shared_ptr<RectRep>;
 
     TextRep(QString text, RectPtr rect);
-    virtual void Draw(QPainter* painter) const override;
+    virtual void DrawShape(QPainter* painter) const override;
+    virtual void DrawHandles(QPainter* painter) const override;
+    virtual void DrawGreeked(QPainter* painter) const override;
+    bool HasText() const override;
     std::shared_ptr<NodeModel> GetModel() const override;
     QString GetText() const;
     void SetText(QString const& text);
 
     private:
     RectPtr m_rect;
-    RectRepPtr m_rectRep;
     QString m_text = "";
-    
+
+    // laid out m_text for the last font it was drawn with,
+    // the mutex lets several painter threads share it
+    mutable QStaticText m_layout;
+    mutable QFont m_layoutFont;
+    mutable bool m_layoutValid = false;
+    mutable std::mutex m_layoutMutex;
 };
 
 class EllipseRep: public NodeModelRep
 {
     public:
-    using RectRepPtr = std::shared_ptr<RectRep>;
     using RectPtr = std::shared_ptr<IntRect>;
 
     EllipseRep(RectPtr const& rect);
-    virtual void Draw(QPainter* painter) const override;
+    virtual void DrawShape(QPainter* painter) const override;
+    virtual void DrawHandles(QPainter* painter) const override;
+    bool AddTo(DrawBatch& batch) const override;
     std::shared_ptr<NodeModel> GetModel() const override;
 
     RectPtr m_rect;
-    RectRepPtr m_rectRep;
 };
\ No newline at end of file
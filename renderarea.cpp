@@ -1,9 +1,15 @@
 #include "renderarea.h"
 #include "drawables.h"
+#include "PosterExport.h"
 
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QInputDialog>
+#include <QMessageBox>
 #include <QPainter>
 #include <QPainterPath>
 #include <QMouseEvent>
+#include <QProgressDialog>
 
 
 RenderArea::RenderArea(QWidget *parent)
@@ -14,6 +20,20 @@ RenderArea::RenderArea(QWidget *parent)
     pixmap.load(":/images/qt-logo.png");
     m_drawablesScene = new DrawablesScene(this);
     connect(m_drawablesScene, &DrawablesScene::Updated, this, [=]() {update(); });
+    connect(m_drawablesScene, &DrawablesScene::RegionUpdated,
+        this, [=](QRegion const& region) {update(region); });
+
+    // blit the frame, only the exposed strip is repainted; the text editor stays in place
+    connect(m_drawablesScene, &DrawablesScene::Scrolled,
+        this, [=](QPoint const& delta)
+        {
+            scroll(delta.x(), delta.y(), rect());
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+            // the HUD is blitted along with the scene
+            if (m_showHud)
+                update(m_hudRect.translated(delta));
+#endif
+        });
     setBackgroundRole(QPalette::Base);
     setAutoFillBackground(true);
 }
@@ -47,17 +67,158 @@ void RenderArea::setBrush(const QBrush &brush)
     update();
 }
 
+void RenderArea::setTileCache(bool enabled)
+{
+    m_drawablesScene->SetTileCacheEnabled(enabled);
+}
+
+void RenderArea::setBatchedDrawing(bool enabled)
+{
+    m_drawablesScene->SetBatchedDrawing(enabled);
+}
+
+void RenderArea::setThreadedDrawing(bool enabled)
+{
+    m_drawablesScene->SetThreadedDrawing(enabled);
+}
+
+// a page directory is picked by its index file
+void RenderArea::openScene()
+{
+    auto fileName = QFileDialog::getOpenFileName(this, tr("Open Scene"), QString(),
+        tr("Scenes (*.idscene);;Paged Scenes (%1);;Diagrams (*.svg *.json)").arg(PagedScene::IndexName));
+    if (fileName.isEmpty())
+        return;
+
+    // diagrams are imported into the open scene
+    QString error;
+    auto file = QFileInfo(fileName);
+    auto suffix = file.suffix().toLower();
+    auto opened = file.fileName() == PagedScene::IndexName ? m_drawablesScene->OpenPaged(file.path(), &error) :
+        suffix == "svg" || suffix == "json" ? m_drawablesScene->Import(fileName, &error) :
+        m_drawablesScene->Load(fileName, &error);
+    if (!opened)
+        QMessageBox::warning(this, tr("Open Scene"), error);
+}
+
+// a paged scene writes its edited chunks back, the others are saved to a new file
+void RenderArea::saveScene()
+{
+    QString error;
+    if (auto pagedScene = m_drawablesScene->GetPagedScene())
+    {
+        if (!pagedScene->WriteBack(&error))
+            QMessageBox::warning(this, tr("Save Scene"), error);
+        return;
+    }
+
+    auto fileName = QFileDialog::getSaveFileName(this, tr("Save Scene"), QString(),
+        tr("Scenes (*.idscene);;Paged Scenes (%1)").arg(PagedScene::IndexName));
+    if (fileName.isEmpty())
+        return;
+
+    auto file = QFileInfo(fileName);
+    auto saved = file.fileName() == PagedScene::IndexName ?
+        m_drawablesScene->SavePaged(file.path(), &error) : m_drawablesScene->Save(fileName, &error);
+    if (!saved)
+        QMessageBox::warning(this, tr("Save Scene"), error);
+}
+
 
-void RenderArea::paintEvent(QPaintEvent * /* event */)
+// the whole scene at print resolution, drawn with the current pen and brush
+void RenderArea::exportPoster()
+{
+    auto bounds = m_drawablesScene->SceneBounds();
+    if (bounds.isEmpty())
+    {
+        QMessageBox::information(this, tr("Export Poster"), tr("There is nothing to export."));
+        return;
+    }
+
+    auto ok = false;
+    auto dpi = QInputDialog::getInt(this, tr("Export Poster"), tr("Resolution (dpi):"), 600, 24, 2400, 1, &ok);
+    if (!ok)
+        return;
+
+    auto fileName = QFileDialog::getSaveFileName(this, tr("Export Poster"), QString(),
+        tr("Portable Arbitrary Maps (*.pam)"));
+    if (fileName.isEmpty())
+        return;
+
+    PosterExport::Options options;
+    options.sceneRect = bounds;
+    options.scale = dpi / PosterExport::ScreenDpi;
+    options.style = PaintStyle{ pen, brush, QPainter::Antialiasing };
+
+    // the progress dialog runs the event loop while the pool draws the shapes
+    DrawablesScene::FreezeScope freeze(*m_drawablesScene, bounds);
+    QProgressDialog progress(tr("Exporting the poster..."), tr("Cancel"), 0, 1000, this);
+    progress.setWindowModality(Qt::WindowModal);
+    PosterExport poster(*m_drawablesScene->GetDrawableActor());
+    poster.SetProgressHandler([&progress](qint64 done, qint64 total)
+        {
+            progress.setValue(int(done * 1000 / total));
+            return !progress.wasCanceled();
+        });
+
+    QString error;
+    if (!poster.Export(fileName, options, &error) && !progress.wasCanceled())
+        QMessageBox::warning(this, tr("Export Poster"), error);
+}
+
+void RenderArea::paintEvent(QPaintEvent* event)
 {
     QPainter painter(this);
+    painter.setClipRegion(event->region());
 
     painter.setPen(pen);
     painter.setBrush(brush);
     painter.setRenderHint(QPainter::Antialiasing, true);
-    
+
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    // the HUD is opaque, a repaint of the HUD alone leaves the scene out
+    if (!m_showHud || !m_hudRect.contains(event->region().boundingRect()))
+        m_drawablesScene->Draw(&painter);
+
+    if (m_showHud)
+    {
+        drawHud(&painter);
+        // a partial repaint of the scene is followed by one of the HUD
+        if (!event->region().contains(m_hudRect))
+            update(m_hudRect);
+    }
+#else
     m_drawablesScene->Draw(&painter);
+#endif
+}
+
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+void RenderArea::drawHud(QPainter* painter)
+{
+    auto stats = m_drawablesScene->GetPerfStats();
+    QString const lines[] = {
+        tr("frame %1 ms  p50 %2  p99 %3").arg(stats.frameMs, 0, 'f', 2)
+            .arg(stats.p50Ms, 0, 'f', 2).arg(stats.p99Ms, 0, 'f', 2),
+        tr("shapes %1 / %2").arg(stats.drawn).arg(stats.shapes),
+        tr("pick %1 ms  sort %2 ms").arg(stats.pickMs, 0, 'f', 3).arg(stats.sortMs, 0, 'f', 3),
+        tr("refresh %1 ms  changes %2").arg(stats.refreshMs, 0, 'f', 3).arg(stats.changesPerFrame),
+    };
+
+    auto metrics = painter->fontMetrics();
+    painter->save();
+    painter->setClipping(false);
+    painter->fillRect(m_hudRect, QColor(32, 32, 32));
+    painter->setPen(Qt::white);
+    auto baseline = m_hudRect.top() + 6 + metrics.ascent();
+    for (auto const& line : lines)
+    {
+        painter->drawText(m_hudRect.left() + 8, baseline, line);
+        baseline += metrics.lineSpacing();
+    }
+    painter->restore();
 }
+#endif
+
 void RenderArea::mouseMoveEvent(QMouseEvent* ev)
 {
     m_drawablesScene->MouseMoveHandler(ev);
@@ -73,6 +234,17 @@ void RenderArea::mouseReleaseEvent(QMouseEvent* ev) //TODO: connect to Grrabbed
 }
 void RenderArea::keyPressEvent(QKeyEvent* event)
 {
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    if (event->key() == Qt::Key_F3)
+    {
+        m_showHud = !m_showHud;
+        auto metrics = fontMetrics();
+        m_hudRect = QRect(8, 8, metrics.horizontalAdvance(tr("frame 000.00 ms  p50 000.00  p99 000.00")) + 16,
+            4 * metrics.lineSpacing() + 12);
+        update();
+        return;
+    }
+#endif
     m_drawablesScene->KeyPressedHandler(event);
 }
 void RenderArea::resizeEvent(QResizeEvent* event)
@@ -24,6 +24,12 @@ class RenderArea : public QWidget
     void setAction(Shape shape);
     void setPen(const QPen& pen);
     void setBrush(const QBrush& brush);
+    void setTileCache(bool enabled);
+    void setBatchedDrawing(bool enabled);
+    void setThreadedDrawing(bool enabled);
+    void openScene();
+    void saveScene();
+    void exportPoster();
 
     protected:
     void paintEvent(QPaintEvent* event) override;
@@ -34,6 +40,12 @@ class RenderArea : public QWidget
     void resizeEvent(QResizeEvent* event) override;
 
     private:
+#if defined(INTERACTIVE_DRAWING_PERF_COUNTERS)
+    // frame times, shapes, pick, sort and refresh times of the scene, toggled with F3
+    void drawHud(QPainter* painter);
+    bool m_showHud = false;
+    QRect m_hudRect;
+#endif
     Shape m_currentShape;
     QPen pen;
     QBrush brush;
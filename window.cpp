@@ -75,6 +75,13 @@ Window::Window()
     brushStyleLabel = new QLabel(tr("&Brush:"));
     brushStyleLabel->setBuddy(brushStyleComboBox);
 
+    tileCacheCheckBox = new QCheckBox(tr("&Tile Cache"));
+    batchedCheckBox = new QCheckBox(tr("Batched &Drawing"));
+    threadedCheckBox = new QCheckBox(tr("Th&readed Drawing"));
+    openButton = new QPushButton(tr("&Open..."));
+    saveButton = new QPushButton(tr("Sa&ve..."));
+    exportButton = new QPushButton(tr("E&xport Poster..."));
+
     connect(shapeComboBox, &QComboBox::activated,
             this, &Window::shapeChanged);
     connect(penWidthSpinBox, &QSpinBox::valueChanged,
@@ -83,6 +90,18 @@ Window::Window()
             this, &Window::penChanged);
     connect(brushStyleComboBox, &QComboBox::activated,
             this, &Window::brushChanged);
+    connect(tileCacheCheckBox, &QCheckBox::toggled,
+            renderArea, &RenderArea::setTileCache);
+    connect(batchedCheckBox, &QCheckBox::toggled,
+            renderArea, &RenderArea::setBatchedDrawing);
+    connect(threadedCheckBox, &QCheckBox::toggled,
+            renderArea, &RenderArea::setThreadedDrawing);
+    connect(openButton, &QPushButton::clicked,
+            renderArea, &RenderArea::openScene);
+    connect(saveButton, &QPushButton::clicked,
+            renderArea, &RenderArea::saveScene);
+    connect(exportButton, &QPushButton::clicked,
+            renderArea, &RenderArea::exportPoster);
 
     auto mainLayout = new QHBoxLayout;
     auto ctrlsLayout = new QGridLayout;
@@ -99,8 +118,14 @@ Window::Window()
     ctrlsLayout->addWidget(penStyleComboBox, 2, 1);
     ctrlsLayout->addWidget(brushStyleLabel, 3, 0, Qt::AlignLeft);
     ctrlsLayout->addWidget(brushStyleComboBox, 3, 1);
-    ctrlsLayout->addWidget(aboutLabel, 4, 0, 1, 2);
-    ctrlsLayout->setRowStretch(5, 8);
+    ctrlsLayout->addWidget(tileCacheCheckBox, 4, 0, 1, 2);
+    ctrlsLayout->addWidget(batchedCheckBox, 5, 0, 1, 2);
+    ctrlsLayout->addWidget(threadedCheckBox, 6, 0, 1, 2);
+    ctrlsLayout->addWidget(openButton, 7, 0);
+    ctrlsLayout->addWidget(saveButton, 7, 1);
+    ctrlsLayout->addWidget(exportButton, 8, 0, 1, 2);
+    ctrlsLayout->addWidget(aboutLabel, 9, 0, 1, 2);
+    ctrlsLayout->setRowStretch(10, 8);
 
     setLayout(mainLayout);
     penChanged();
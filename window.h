@@ -6,6 +6,7 @@ QT_BEGIN_NAMESPACE
 class QCheckBox;
 class QComboBox;
 class QLabel;
+class QPushButton;
 class QSpinBox;
 QT_END_NAMESPACE
 class RenderArea;
@@ -33,4 +34,10 @@ private:
     QSpinBox *penWidthSpinBox;
     QComboBox *penStyleComboBox;
     QComboBox *brushStyleComboBox;
+    QCheckBox *tileCacheCheckBox;
+    QCheckBox *batchedCheckBox;
+    QCheckBox *threadedCheckBox;
+    QPushButton *openButton;
+    QPushButton *saveButton;
+    QPushButton *exportButton;
 };